@@ -18,6 +18,7 @@
 *   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 #include "aes.h"
+#include "perf_counters.h"
 
 #define F(x)   (((x)<<1) ^ ((((x)>>7) & 1) * 0x1b))
 #define FD(x)  (((x) >> 1) ^ (((x) & 1) ? 0x8d : 0))
@@ -319,6 +320,7 @@ void aes256_encrypt_ecb(aes256_context *ctx, uint8_t *buf)
 {
     uint8_t i, rcon;
 
+    PERF_COUNT(PERF_CNT_AES_BLOCKS, 1);
     aes_addRoundKey_cpy(buf, ctx->enckey, ctx->key);
     for(i = 1, rcon = 1; i < 14; ++i)
     {
@@ -339,6 +341,7 @@ void aes256_decrypt_ecb(aes256_context *ctx, uint8_t *buf)
 {
     uint8_t i, rcon;
 
+    PERF_COUNT(PERF_CNT_AES_BLOCKS, 1);
     aes_addRoundKey_cpy(buf, ctx->deckey, ctx->key);
     aes_shiftRows_inv(buf);
     aes_subBytes_inv(buf);
@@ -185,6 +185,46 @@ void setBBModeAndPgmRstSMC(void)
     #endif
 }
 
+/*! \fn     clockPulsesSMC(uint16_t nb_pulses)
+*   \brief  Send a given number of clock pulses with data low, to move the card address counter
+*   \param  nb_pulses   Number of clock pulses
+*   \note   Must be called in bit banging mode, clock and data low. Whole bytes are clocked by the SPI controller (same 4us period as clockPulseSMC), the remaining bits are bit banged
+*/
+void clockPulsesSMC(uint16_t nb_pulses)
+{
+    #if SPI_SMARTCARD == SPI_NATIVE
+        uint16_t nb_bytes = nb_pulses >> 3;
+
+        if (nb_bytes != 0)
+        {
+            /* Enable SPI in master mode at 250kbits/s, clock idle low as in bit banging mode */
+            SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPR1);
+
+            while(nb_bytes--)
+            {
+                /* Start transmission */
+                SPDR = 0x00;
+                /* Wait for transmission complete */
+                while((!(SPSR & (1<<SPIF))) && (isSmartCardAbsent() == RETURN_NOK));
+                SPDR;
+            }
+
+            /* Back to bit banging, clock and data are still low */
+            SPCR = 0;
+            smartcardHPulseDelay();
+        }
+
+        /* Bit bang the remaining pulses */
+        nb_pulses &= 0x0007;
+        while(nb_pulses--)
+        {
+            clockPulseSMC();
+        }
+    #else
+        #error "SPI not supported"
+    #endif
+}
+
 /*! \fn     blowFuse(uint8_t fuse_name)
 *   \brief  Blow the manufacturer or issuer fuse
 *   \param  fuse_name    Which fuse to blow
@@ -215,7 +255,7 @@ void blowFuse(uint8_t fuse_name)
     setBBModeAndPgmRstSMC();
 
     /* Get to the good index */
-    while(i--)clockPulseSMC();
+    clockPulsesSMC(i);
 
     /* Set RST signal */
     PORT_SC_RST |= (1 << PORTID_SC_RST);
@@ -323,8 +363,9 @@ void eraseApplicationZone1NZone2SMC(uint8_t zone1_nzone2)
         /* Switch to bit banging */
         setBBModeAndPgmRstSMC();
 
-        /* Get to the good EZx */
-        while(i--) invertedClockPulseSMC();
+        /* Get to the good EZx: N inverted pulses are N-1 normal pulses followed by a L->H pulse */
+        clockPulsesSMC(i - 1);
+        invertedClockPulseSMC();
 
         /* How many bits to compare */
         if (zone1_nzone2 == FALSE)
@@ -413,9 +454,9 @@ RET_TYPE securityValidationSMC(volatile uint16_t* code)
         /* Switch to bit banging */
         setBBModeAndPgmRstSMC();
 
-        /* Get to the SC */
-        for(i = 0; i < 80; i++)
-            invertedClockPulseSMC();
+        /* Get to the SC: 80 inverted pulses are 79 normal pulses followed by a L->H pulse */
+        clockPulsesSMC(79);
+        invertedClockPulseSMC();
 
         /* Clock is at high level now, as input must be switched during this time */
         /* Enter the SC */
@@ -528,7 +569,6 @@ void writeSMC(uint16_t start_index_bit, uint16_t nb_bits, uint8_t* data_to_write
 {
     uint16_t current_written_bit = 0;
     uint8_t masked_bit_to_write = 0;
-    uint16_t i;
 
     #if SPI_SMARTCARD == SPI_NATIVE
         /* Switch to bit banging */
@@ -538,26 +578,17 @@ void writeSMC(uint16_t start_index_bit, uint16_t nb_bits, uint8_t* data_to_write
         if (start_index_bit >= SMARTCARD_AZ2_BIT_START)
         {
             /* Clock pulses until AZ2 start - 1 */
-            for(i = 0; i < SMARTCARD_AZ2_BIT_START - 1; i++)
-            {
-                clockPulseSMC();            
-            }                
+            clockPulsesSMC(SMARTCARD_AZ2_BIT_START - 1);
             PORT_SPI_NATIVE |= (1 << MOSI_SPI_NATIVE);
             clockPulseSMC();
             PORT_SPI_NATIVE &= ~(1 << MOSI_SPI_NATIVE);
             /* Clock for the rest */
-            for(i = 0; i < (start_index_bit - SMARTCARD_AZ2_BIT_START); i++)
-            {
-                clockPulseSMC();            
-            }                
+            clockPulsesSMC(start_index_bit - SMARTCARD_AZ2_BIT_START);
         }
         else
         {
             /* Get to the good index, clock pulses */
-            for(i = 0; i < start_index_bit; i++)
-            {
-                clockPulseSMC();
-            }                
+            clockPulsesSMC(start_index_bit);
         }
 
         /* Start writing */
@@ -42,6 +42,7 @@ RET_TYPE isCardPlugged(void);
 void removeFunctionSMC(void);
 void scanSMCDectect(void);
 void setSPIModeSMC(void);
+void clockPulsesSMC(uint16_t nb_pulses);
 void initPortSMC(void);
 
 // Macros
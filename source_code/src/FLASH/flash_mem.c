@@ -23,6 +23,7 @@
 */
 #include "flash_mem.h"
 #include "flash_mem_private.h"
+#include "perf_counters.h"
 
 /**
  * Reads the flash chip status register
@@ -67,26 +68,14 @@ static inline flash_man_dev_id_t flash_read_manufacturer_device_id(void)
 }
 
 /**
- * Private internal library function to send an opcode along with data.
- * Not all parameters need to be used.
+ * Private internal library function to assert chip select and send an opcode along with its address.
  * @param   page    The target page number of flash memory
- * @param   offset  The starting byte offset to begin reading in pageNumber
- * @param   data    The buffer used to store the data read from flash
- * @param   size    The number of bytes to read from the flash memory into the data buffer
+ * @param   offset  The starting byte offset in page
  * @param   opcode  The opcode of the flash chip function to execute
- * @param   write   Boolean to determine if a write or read operation should be executed
- * @return  error code, zero means no error
- * @note    Function DOES allow crossing page boundaries but prevents invalid page/offset inputs
+ * @note    Chip select is left asserted, page and offset are not checked
  */
-static inline flash_ret_t flash_transfer_opcode_data
-(uint16_t page, uint16_t offset, uint8_t* data, size_t size, flash_opcode_t opcode, bool write)
+static inline void flash_select_opcode_address(uint16_t page, uint16_t offset, flash_opcode_t opcode)
 {
-    // Check page and offset limits
-    if((page >= FLASH_PAGE_COUNT) || (offset >= FLASH_BYTES_PER_PAGE))
-    {
-        return FLASH_RET_ERR_INPUT_PARAM;
-    }
-
     // Construct opcode
     flash_opcode_addr_t op;
     op.opcode = opcode;
@@ -109,6 +98,31 @@ static inline flash_ret_t flash_transfer_opcode_data
 
     // Send opcode with MSB first
     spi_usart_write_msb(op.raw, sizeof(flash_opcode_addr_t));
+}
+
+/**
+ * Private internal library function to send an opcode along with data.
+ * Not all parameters need to be used.
+ * @param   page    The target page number of flash memory
+ * @param   offset  The starting byte offset to begin reading in pageNumber
+ * @param   data    The buffer used to store the data read from flash
+ * @param   size    The number of bytes to read from the flash memory into the data buffer
+ * @param   opcode  The opcode of the flash chip function to execute
+ * @param   write   Boolean to determine if a write or read operation should be executed
+ * @return  error code, zero means no error
+ * @note    Function DOES allow crossing page boundaries but prevents invalid page/offset inputs
+ */
+static inline flash_ret_t flash_transfer_opcode_data
+(uint16_t page, uint16_t offset, uint8_t* data, size_t size, flash_opcode_t opcode, bool write)
+{
+    // Check page and offset limits
+    if((page >= FLASH_PAGE_COUNT) || (offset >= FLASH_BYTES_PER_PAGE))
+    {
+        return FLASH_RET_ERR_INPUT_PARAM;
+    }
+
+    // Assert chip select, send opcode and address
+    flash_select_opcode_address(page, offset, opcode);
 
     // Retrieve data
     if(write)
@@ -120,6 +134,22 @@ static inline flash_ret_t flash_transfer_opcode_data
         spi_usart_read(data, size);
     }
 
+    // Performance counters
+    if(opcode == FLASH_OPCODE_ERASE_PAGE)
+    {
+        PERF_COUNT(PERF_CNT_FLASH_ERASES, 1);
+    }
+    else if(write)
+    {
+        PERF_COUNT(PERF_CNT_FLASH_WRITES, 1);
+        PERF_COUNT(PERF_CNT_FLASH_BYTES_WRITE, size);
+    }
+    else
+    {
+        PERF_COUNT(PERF_CNT_FLASH_READS, 1);
+        PERF_COUNT(PERF_CNT_FLASH_BYTES_READ, size);
+    }
+
     // Deassert chip select
     FLASH_PORT_SS |= (1 << FLASH_BIT_SS);
 
@@ -127,10 +157,12 @@ static inline flash_ret_t flash_transfer_opcode_data
     // TODO move for read?
     if(write){
     flash_status_reg_t status_reg;
+    PERF_TIMESTAMP(wait_start);
     do
     {
         status_reg = flash_read_status_reg();
     } while(!status_reg.ready0);
+    PERF_ADD_ELAPSED(PERF_CNT_FLASH_WAIT_US, wait_start);
 
     // Check for erase or programming errors
     if (status_reg.erase_program_error)
@@ -255,6 +287,46 @@ flash_ret_t flash_read_raw_far(uint32_t addr, uint8_t* data, size_t size)
     return flash_transfer_opcode_data(page, offset, data, size, FLASH_OPCODE_READ_LOW_POWER, false);
 }
 
+/**
+ * Start a continuous read session: chip select stays asserted and data is clocked out on demand
+ * @param   addr            byte offset in the flash
+ * @return  error code, zero means no error
+ * @note    Nothing else can use the SPI bus until flash_read_stream_stop() is called
+ */
+flash_ret_t flash_read_stream_start(uint16_t addr)
+{
+    // Check flash boundary
+    if((uint32_t)addr >= FLASH_SIZE)
+    {
+        return FLASH_RET_ERR_INPUT_PARAM;
+    }
+
+    // Continuous array read, the chip wraps across page boundaries by itself
+    flash_select_opcode_address(addr / FLASH_BYTES_PER_PAGE, addr % FLASH_BYTES_PER_PAGE, FLASH_OPCODE_READ_LOW_POWER);
+    PERF_COUNT(PERF_CNT_FLASH_READS, 1);
+    return FLASH_RET_OK;
+}
+
+/**
+ * Read the next bytes of a continuous read session
+ * @param   data            pointer to the buffer to store the read data
+ * @param   size            the number of bytes to read
+ */
+void flash_read_stream(uint8_t* data, size_t size)
+{
+    spi_usart_read(data, size);
+    PERF_COUNT(PERF_CNT_FLASH_BYTES_READ, size);
+}
+
+/**
+ * Stop a continuous read session
+ */
+void flash_read_stream_stop(void)
+{
+    // Deassert chip select
+    FLASH_PORT_SS |= (1 << FLASH_BIT_SS);
+}
+
 /**
  * Contiguous data write across flash page boundaries with a max 65k bytes addressing space
  * @param   addr            byte offset in the flash
@@ -356,6 +428,67 @@ flash_ret_t flash_write_buffer_to_page(uint16_t page)
     return flash_transfer_opcode_data(page, 0 , NULL, 0, FLASH_OPCODE_WRITE_BUF2_TO_PAGE, true);
 }
 
+/**
+ * Load a given page in the flash internal buffer 1
+ * @param   page      The target page number of flash memory
+ * @return  error code, zero means no error
+ * @note    Buffer 1 is also used by flash_write_page(), which overwrites its contents
+ */
+flash_ret_t flash_read_into_buffer1(uint16_t page)
+{
+    return flash_transfer_opcode_data(page, 0, NULL, 0, FLASH_OPCODE_READ_INTO_BUF1, true);
+}
+
+/**
+ * Write data into the internal memory buffer 1.
+ * Use flash_write_buffer1_to_page() afterwards to save the buffer.
+ * @param offset offset to start writing to in the internal memory buffer
+ * @param data   pointer to data to write
+ * @param size   the number of bytes to write
+ * @return  error code, zero means no error
+ * @note    Function does not allow crossing page boundaries.
+ */
+flash_ret_t flash_write_into_buffer1(uint16_t offset, uint8_t* data, size_t size)
+{
+    // Check if offset crossed page boundaries
+    if((offset + size - 1) >= FLASH_BYTES_PER_PAGE)
+    {
+        return FLASH_RET_ERR_INPUT_PARAM;
+    }
+
+    return flash_transfer_opcode_data(0, offset, data, size, FLASH_OPCODE_WRITE_INTO_BUF1, true);
+}
+
+/**
+ * Read data from the internal memory buffer 1.
+ * @param offset offset to start reading from in the internal memory buffer
+ * @param data   pointer to the buffer to store the read data
+ * @param size   the number of bytes to read
+ * @return  error code, zero means no error
+ * @note    Function does not allow crossing page boundaries.
+ */
+flash_ret_t flash_read_buffer1(uint16_t offset, uint8_t* data, size_t size)
+{
+    // Check if offset crossed page boundaries
+    if((offset + size - 1) >= FLASH_BYTES_PER_PAGE)
+    {
+        return FLASH_RET_ERR_INPUT_PARAM;
+    }
+
+    return flash_transfer_opcode_data(0, offset, data, size, FLASH_OPCODE_READ_BUF1_LOW_FREQUENCY, false);
+}
+
+/**
+ * Write the contents of the internal memory buffer 1 to a page in flash
+ * Use it after flash_write_into_buffer1()
+ * @param   page the page to store the buffer in
+ * @return  error code, zero means no error
+ */
+flash_ret_t flash_write_buffer1_to_page(uint16_t page)
+{
+    return flash_transfer_opcode_data(page, 0 , NULL, 0, FLASH_OPCODE_WRITE_BUF1_TO_PAGE, true);
+}
+
 /**
  * Erases page pageNumber (0 up to FLASH_PAGE_COUNT valid).
  * @param   page      The page to erase
@@ -60,6 +60,10 @@ void flashWriteBufferToPage(uint16_t page);
 void loadPageToInternalBuffer(uint16_t page_number);
 void flashRawRead(uint8_t* datap, uint16_t addr, size_t size);
 void flashWriteBuffer(uint8_t* datap, uint16_t offset, size_t size);
+void loadPageToInternalBuffer1(uint16_t page_number);
+void flashWriteBuffer1(uint8_t* datap, uint16_t offset, size_t size);
+void flashReadBuffer1(uint8_t* datap, uint16_t offset, size_t size);
+void flashWriteBuffer1ToPage(uint16_t page);
 void writeDataToFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 
@@ -83,6 +87,9 @@ flash_ret_t flash_write_page(uint16_t page, uint16_t offset, uint8_t* data, size
 // Flash page read/write raw operations
 flash_ret_t flash_read_raw(uint16_t addr, uint8_t* data, size_t size);
 flash_ret_t flash_read_raw_far(uint32_t addr, uint8_t* data, size_t size);
+flash_ret_t flash_read_stream_start(uint16_t addr);
+void flash_read_stream(uint8_t* data, size_t size);
+void flash_read_stream_stop(void);
 flash_ret_t flash_write_raw(uint16_t addr, uint8_t* data, size_t size);
 flash_ret_t flash_write_raw_far(uint32_t addr, uint8_t* data, size_t size);
 
@@ -90,6 +97,10 @@ flash_ret_t flash_write_raw_far(uint32_t addr, uint8_t* data, size_t size);
 flash_ret_t flash_read_into_buffer(uint16_t page);
 flash_ret_t flash_write_into_buffer(uint16_t offset, uint8_t* data, size_t size);
 flash_ret_t flash_write_buffer_to_page(uint16_t page);
+flash_ret_t flash_read_into_buffer1(uint16_t page);
+flash_ret_t flash_write_into_buffer1(uint16_t offset, uint8_t* data, size_t size);
+flash_ret_t flash_read_buffer1(uint16_t offset, uint8_t* data, size_t size);
+flash_ret_t flash_write_buffer1_to_page(uint16_t page);
 static inline flash_ret_t flash_rewrite_page(uint16_t page) __attribute__((always_inline));
 
 // Flash erase functions
@@ -117,6 +128,7 @@ flash_ret_t flash_rewrite_page(uint16_t page)
     #define FLASH_PAGE_COUNT 512UL     // Number of pages in the chip
     #define FLASH_BYTES_PER_PAGE 264UL // Bytes per page of the chip
     #define FLASH_SIZE (FLASH_PAGE_COUNT * FLASH_BYTES_PER_PAGE)
+    #define FLASH_PAGES_PER_SECTOR 128UL // Pages per sector, sector 0 being split in 0a & 0b
 
 // Used to identify a 2M Flash Chip (AT45DB021E)
 #elif defined(FLASH_CHIP_2M)
@@ -127,6 +139,7 @@ flash_ret_t flash_rewrite_page(uint16_t page)
     #define FLASH_PAGE_COUNT 1024UL    // Number of pages in the chip
     #define FLASH_BYTES_PER_PAGE 264UL // Bytes per page of the chip
     #define FLASH_SIZE (FLASH_PAGE_COUNT * FLASH_BYTES_PER_PAGE)
+    #define FLASH_PAGES_PER_SECTOR 128UL // Pages per sector, sector 0 being split in 0a & 0b
 
 // Used to identify a 4M Flash Chip (AT45DB041E)
 #elif defined(FLASH_CHIP_4M)
@@ -137,6 +150,7 @@ flash_ret_t flash_rewrite_page(uint16_t page)
     #define FLASH_PAGE_COUNT 2048UL    // Number of pages in the chip
     #define FLASH_BYTES_PER_PAGE 264UL // Bytes per page of the chip
     #define FLASH_SIZE (FLASH_PAGE_COUNT * FLASH_BYTES_PER_PAGE)
+    #define FLASH_PAGES_PER_SECTOR 256UL // Pages per sector, sector 0 being split in 0a & 0b
 
 // Used to identify a 8M Flash Chip (AT45DB081E)
 #elif defined(FLASH_CHIP_8M)
@@ -147,6 +161,7 @@ flash_ret_t flash_rewrite_page(uint16_t page)
     #define FLASH_PAGE_COUNT 4096UL    // Number of pages in the chip
     #define FLASH_BYTES_PER_PAGE 264UL // Bytes per page of the chip
     #define FLASH_SIZE (FLASH_PAGE_COUNT * FLASH_BYTES_PER_PAGE)
+    #define FLASH_PAGES_PER_SECTOR 256UL // Pages per sector, sector 0 being split in 0a & 0b
 
 // Used to identify a 16M Flash Chip (AT45DB161E)
 #elif defined(FLASH_CHIP_16M)
@@ -157,6 +172,7 @@ flash_ret_t flash_rewrite_page(uint16_t page)
     #define FLASH_PAGE_COUNT 4096UL    // Number of pages in the chip
     #define FLASH_BYTES_PER_PAGE 528UL // Bytes per page of the chip
     #define FLASH_SIZE (FLASH_PAGE_COUNT * FLASH_BYTES_PER_PAGE)
+    #define FLASH_PAGES_PER_SECTOR 256UL // Pages per sector, sector 0 being split in 0a & 0b
 
 // Used to identify a 32M Flash Chip (AT45DB321E)
 #elif defined(FLASH_CHIP_32M)
@@ -167,6 +183,7 @@ flash_ret_t flash_rewrite_page(uint16_t page)
     #define FLASH_PAGE_COUNT 8192UL    // Number of pages in the chip
     #define FLASH_BYTES_PER_PAGE 528UL // Bytes per page of the chip
     #define FLASH_SIZE (FLASH_PAGE_COUNT * FLASH_BYTES_PER_PAGE)
+    #define FLASH_PAGES_PER_SECTOR 128UL // Pages per sector, sector 0 being split in 0a & 0b
 
 #else
     #error "No flash chip size defined"
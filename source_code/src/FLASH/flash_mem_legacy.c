@@ -162,3 +162,67 @@ void flashWriteBufferToPage(uint16_t page)
     }
     #endif
 }
+
+void loadPageToInternalBuffer1(uint16_t pageNumber)
+{
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    flash_ret_t ret =
+    #endif
+    flash_read_into_buffer1(pageNumber);
+
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    // Error check the parameter pageNumber and offset
+    if(ret == FLASH_RET_ERR_INPUT_PARAM)
+    {
+        memoryBoundaryErrorCallback();
+    }
+    #endif
+}
+
+void flashWriteBuffer1(uint8_t* datap, uint16_t offset, size_t size)
+{
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    flash_ret_t ret =
+    #endif
+    flash_write_into_buffer1(offset, datap, size);
+
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    // Error check the parameter pageNumber and offset
+    if(ret == FLASH_RET_ERR_INPUT_PARAM)
+    {
+        memoryBoundaryErrorCallback();
+    }
+    #endif
+}
+
+void flashReadBuffer1(uint8_t* datap, uint16_t offset, size_t size)
+{
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    flash_ret_t ret =
+    #endif
+    flash_read_buffer1(offset, datap, size);
+
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    // Error check the parameter pageNumber and offset
+    if(ret == FLASH_RET_ERR_INPUT_PARAM)
+    {
+        memoryBoundaryErrorCallback();
+    }
+    #endif
+}
+
+void flashWriteBuffer1ToPage(uint16_t page)
+{
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    flash_ret_t ret =
+    #endif
+    flash_write_buffer1_to_page(page);
+
+    #ifdef MEMORY_BOUNDARY_CHECKS
+    // Error check the parameter pageNumber and offset
+    if(ret == FLASH_RET_ERR_INPUT_PARAM)
+    {
+        memoryBoundaryErrorCallback();
+    }
+    #endif
+}
@@ -43,13 +43,14 @@ typedef enum __attribute__((packed))
 
     FLASH_OPCODE_READ_LOW_POWER = 0x01,
     //FLASH_OPCODE_READ_LOW_FREQUENCY = 0x03,
+    FLASH_OPCODE_READ_BUF1_LOW_FREQUENCY = 0xD1,
 
     FLASH_OPCODE_READ_MODIFY_WRITE_BUF1 = 0x58,
     //FLASH_OPCODE_READ_MODIFY_WRITE_BUF2 = 0x59,
 
-    //FLASH_OPCODE_READ_INTO_BUF1 = 0x53,
-    //FLASH_OPCODE_WRITE_INTO_BUF1 = 0x84,
-    //FLASH_OPCODE_WRITE_BUF1_TO_PAGE = 0x83,
+    FLASH_OPCODE_READ_INTO_BUF1 = 0x53,
+    FLASH_OPCODE_WRITE_INTO_BUF1 = 0x84,
+    FLASH_OPCODE_WRITE_BUF1_TO_PAGE = 0x83,
     FLASH_OPCODE_READ_INTO_BUF2 = 0x55,
     FLASH_OPCODE_WRITE_INTO_BUF2 = 0x87,
     FLASH_OPCODE_WRITE_BUF2_TO_PAGE = 0x86,
@@ -84,6 +84,12 @@ pNode temp_pnode;
 cNode temp_cnode;
 // Data node ptr;
 dNode* temp_dnode_ptr = (dNode*)&temp_cnode;
+// Credential batch: parent node of the current service, also the cursor for the next one
+uint16_t batch_parent_node_addr = NODE_ADDR_NULL;
+// Credential batch: child node of the current login, NODE_ADDR_NULL if it needs to be created
+uint16_t batch_child_node_addr;
+// Credential batch: set once the login of the current credential is received
+uint8_t batch_login_valid_flag = FALSE;
 
 #ifdef ENABLE_CREDENTIAL_MANAGEMENT
 // management mode state for login selection state machine
@@ -366,18 +372,15 @@ void decrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
     while (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING);
 }
 
-/*! \fn     encrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
-*   \brief  Encrypt a block of data, clear credential_timer_valid
-*   \param  data    Data to be decrypted
+/*! \fn     encrypt32bBlockOfData(uint8_t* data, uint8_t* ctr)
+*   \brief  Encrypt a block of data, the caller takes care of the constant time window
+*   \param  data    Data to be encrypted
 *   \param  ctr     Pointer to where to store the ctr
 */
-void encrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
+static inline void encrypt32bBlockOfData(uint8_t* data, uint8_t* ctr)
 {
     uint8_t temp_buffer[AES256_CTR_LENGTH];
 
-    // Preventing side channel attacks: only send the return after a given amount of time
-    activateTimer(TIMER_CREDENTIALS, AES_ENCR_DECR_TIMER_VAL);
-
     // AES encryption: xor our nonce with the next available ctr value, set the result as IV, encrypt, increment our next available ctr value
     ctrPreEncryptionTasks();
     memcpy((void*)temp_buffer, (void*)current_nonce, AES256_CTR_LENGTH);
@@ -386,6 +389,19 @@ void encrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
     aes256CtrEncrypt(&aesctx, data, AES_ROUTINE_ENC_SIZE);
     memcpy((void*)ctr, (void*)nextCtrVal, USER_CTR_SIZE);
     ctrPostEncryptionTasks();
+}
+
+/*! \fn     encrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
+*   \brief  Encrypt a block of data, clear credential_timer_valid
+*   \param  data    Data to be decrypted
+*   \param  ctr     Pointer to where to store the ctr
+*/
+void encrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
+{
+    // Preventing side channel attacks: only send the return after a given amount of time
+    activateTimer(TIMER_CREDENTIALS, AES_ENCR_DECR_TIMER_VAL);
+
+    encrypt32bBlockOfData(data, ctr);
 
     // Wait for credential timer to fire (we wanted to clear credential_timer_valid flag anyway)
     while (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING);
@@ -612,6 +628,9 @@ RET_TYPE getPasswordForContext(char* buffer)
         strcpy((char*)buffer, (char*)temp_cnode.password);
         memset((void*)temp_cnode.password, 0x00, NODE_CHILD_SIZE_OF_PASSWORD);
 
+        // Record credential use
+        markChildNodeAsUsed(selected_login_child_node_addr);
+
         // Timer fired, return
         return RETURN_OK;
     }
@@ -879,6 +898,87 @@ RET_TYPE setPasswordForContext(uint8_t* password, uint8_t length)
     }
 }
 
+/*! \fn     resetCredentialBatch(void)
+*   \brief  Forget the credential batch state, called when entering memory management mode
+*/
+void resetCredentialBatch(void)
+{
+    batch_parent_node_addr = NODE_ADDR_NULL;
+    batch_login_valid_flag = FALSE;
+}
+
+/*! \fn     storeCredentialBatchField(uint8_t field, uint8_t* string, uint8_t length)
+*   \brief  Store a field of a credential batch, sent during memory management mode
+*   \param  field   BATCH_FIELD_SERVICE, BATCH_FIELD_LOGIN or BATCH_FIELD_PASSWORD
+*   \param  string  String containing the field
+*   \param  length  String length
+*   \return Operation success or not
+*   \note   The credential is stored when its password is received, an existing one is overwritten
+*   \note   Services sorted in ascending order are merged in a single pass over the parent list
+*/
+RET_TYPE storeCredentialBatchField(uint8_t field, uint8_t* string, uint8_t length)
+{
+    uint8_t temp_ctr[USER_CTR_SIZE];
+    RET_TYPE ret_val;
+
+    if (field == BATCH_FIELD_SERVICE)
+    {
+        // The plugin context shares our temporary nodes
+        context_valid_flag = FALSE;
+        selected_login_flag = FALSE;
+        batch_login_valid_flag = FALSE;
+
+        memset((void*)&temp_pnode, 0x00, NODE_SIZE);
+        memcpy((void*)temp_pnode.service, (void*)string, length);
+        if (mergeParentNode(&temp_pnode, &batch_parent_node_addr) != RETURN_OK)
+        {
+            batch_parent_node_addr = NODE_ADDR_NULL;
+            return RETURN_NOK;
+        }
+        return RETURN_OK;
+    }
+    else if ((field == BATCH_FIELD_LOGIN) && (batch_parent_node_addr != NODE_ADDR_NULL))
+    {
+        // The search uses temp_cnode
+        batch_child_node_addr = searchForLoginInGivenParent(batch_parent_node_addr, string);
+        memset((void*)&temp_cnode, 0x00, NODE_SIZE);
+        memcpy((void*)temp_cnode.login, (void*)string, length);
+        batch_login_valid_flag = TRUE;
+        return RETURN_OK;
+    }
+    else if ((field == BATCH_FIELD_PASSWORD) && (batch_login_valid_flag != FALSE))
+    {
+        batch_login_valid_flag = FALSE;
+
+        // Put random bytes after the final 0
+        fillArrayWithRandomBytes(string + length, NODE_CHILD_SIZE_OF_PASSWORD - length);
+
+        // Flash writes are done inside the constant time window instead of after it
+        activateTimer(TIMER_CREDENTIALS, AES_ENCR_DECR_TIMER_VAL);
+        encrypt32bBlockOfData(string, temp_ctr);
+
+        if (batch_child_node_addr == NODE_ADDR_NULL)
+        {
+            memcpy((void*)temp_cnode.password, (void*)string, NODE_CHILD_SIZE_OF_PASSWORD);
+            memcpy((void*)temp_cnode.ctr, (void*)temp_ctr, USER_CTR_SIZE);
+            ret_val = createChildNode(batch_parent_node_addr, &temp_cnode);
+        }
+        else
+        {
+            ret_val = updateChildNodePassword(&temp_cnode, batch_child_node_addr, string, temp_ctr);
+        }
+        userDBChangedActions();
+
+        // Wait for credential timer to fire
+        while (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING);
+        return ret_val;
+    }
+    else
+    {
+        return RETURN_NOK;
+    }
+}
+
 /*! \fn     addDataForDataContext(uint8_t* data, uint8_t last_packet_flag)
 *   \brief  Add 32 bytes of data to our current data parent
 *   \param  data                Block of data to add
@@ -1159,6 +1259,7 @@ RET_TYPE askUserForLoginAndPasswordKeybOutput(uint16_t child_address, char* serv
                 {
                     usbKeybPutStr((char*)temp_cnode.password);
                     memset((void*)temp_cnode.password, 0x00, NODE_CHILD_SIZE_OF_PASSWORD);
+                    markChildNodeAsUsed(child_address);
                     if (getMooltipassParameterInEeprom(KEY_AFTER_PASS_SEND_BOOL_PARAM) != FALSE)
                     {
                         usbKeyboardPress(getMooltipassParameterInEeprom(KEY_AFTER_PASS_SEND_PARAM), 0);
@@ -1189,6 +1290,7 @@ RET_TYPE askUserForLoginAndPasswordKeybOutput(uint16_t child_address, char* serv
                 {
                     guiDisplayLoginOrPasswordOnScreen((char*)temp_cnode.password);
                     memset((void*)temp_cnode.password, 0x00, NODE_CHILD_SIZE_OF_PASSWORD);
+                    markChildNodeAsUsed(child_address);
                     return RETURN_OK;
                 }
                 else if (confirmation_result == RETURN_BACK)
@@ -1244,6 +1346,7 @@ RET_TYPE askUserForLoginAndPasswordKeybOutput(uint16_t child_address, char* serv
             {
                 usbKeybPutStr((char*)temp_cnode.password);
                 memset((void*)temp_cnode.password, 0x00, NODE_CHILD_SIZE_OF_PASSWORD);
+                markChildNodeAsUsed(child_address);
                 if (getMooltipassParameterInEeprom(KEY_AFTER_PASS_SEND_BOOL_PARAM) != FALSE)
                 {
                     usbKeyboardPress(getMooltipassParameterInEeprom(KEY_AFTER_PASS_SEND_PARAM), 0);
@@ -1257,6 +1360,7 @@ RET_TYPE askUserForLoginAndPasswordKeybOutput(uint16_t child_address, char* serv
             {
                 guiDisplayLoginOrPasswordOnScreen((char*)temp_cnode.password);
                 memset((void*)temp_cnode.password, 0x00, NODE_CHILD_SIZE_OF_PASSWORD);
+                markChildNodeAsUsed(child_address);
             }
         }
         #endif
@@ -49,6 +49,7 @@ uint16_t searchForServiceName(uint8_t* name, uint8_t mode, uint8_t type);
 RET_TYPE addDataForDataContext(uint8_t* data, uint8_t last_packet_flag);
 RET_TYPE addNewContext(uint8_t* name, uint8_t length, uint8_t type);
 RET_TYPE setPasswordForContext(uint8_t* password, uint8_t length);
+RET_TYPE storeCredentialBatchField(uint8_t field, uint8_t* string, uint8_t length);
 void initEncryptionHandling(uint8_t* aes_key, uint8_t* nonce);
 RET_TYPE setLoginForContext(uint8_t* name, uint8_t length);
 RET_TYPE get32BytesDataForCurrentService(uint8_t* buffer);
@@ -64,6 +65,7 @@ void clearSmartCardInsertedUnlocked(void);
 void setSmartCardInsertedUnlocked(void);
 void eraseFlashUsersContents(void);
 void ctrPreEncryptionTasks(void);
+void resetCredentialBatch(void);
 void favoritePickingLogic(void);
 void loginSelectLogic(void);
 
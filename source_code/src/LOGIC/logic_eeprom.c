@@ -77,6 +77,88 @@ static const uint8_t eeprom_param_init[] __attribute__((__progmem__)) =
     FALSE,                  // RANDOM_INIT_PIN_PARAM                Random PIN when card inserted
 };
 
+// RAM index of the SMC CPZ <> user id LUT: one CPZ hash per slot, used slots & used user ids bitmaps
+uint8_t smc_uid_lut_cpz_hashes[NB_MAX_SMCID_UID_MATCH_ENTRIES];
+uint8_t smc_uid_lut_used_slots[(NB_MAX_SMCID_UID_MATCH_ENTRIES+7)/8];
+uint16_t smc_uid_lut_used_user_ids;
+#if NODE_MAX_UID > 16
+    #error "Used user ids bitmap is too small"
+#endif
+
+
+/*! \fn     smcCpzHash(uint8_t* cpz)
+*   \brief  Compute the short hash of a CPZ used by the LUT RAM index
+*   \param  cpz     Buffer containing the CPZ
+*   \return The hash
+*/
+static uint8_t smcCpzHash(uint8_t* cpz)
+{
+    uint8_t hash = 0;
+    
+    for (uint8_t i = 0; i < SMARTCARD_CPZ_LENGTH; i++)
+    {
+        hash = ((hash << 1) | (hash >> 7)) ^ cpz[i];
+    }
+    return hash;
+}
+
+/*! \fn     isSmcUidLutSlotUsed(uint8_t slot)
+*   \brief  Know if a LUT slot is used, from the RAM index
+*   \param  slot    The slot number
+*   \return TRUE or FALSE
+*/
+static inline uint8_t isSmcUidLutSlotUsed(uint8_t slot)
+{
+    return (smc_uid_lut_used_slots[slot >> 3] & (1 << (slot & 0x07))) != 0;
+}
+
+/*! \fn     smcUidLutAddress(uint8_t slot)
+*   \brief  Get the eeprom address of a LUT slot
+*   \param  slot    The slot number
+*   \return The address
+*/
+static inline uint16_t smcUidLutAddress(uint8_t slot)
+{
+    return EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)slot*SMCID_UID_MATCH_ENTRY_LENGTH;
+}
+
+/*! \fn     addSmcUidLutIndexEntry(uint8_t slot, uint8_t userid, uint8_t* cpz)
+*   \brief  Add a LUT entry to the RAM index
+*   \param  slot    The slot number
+*   \param  userid  The entry user id
+*   \param  cpz     Buffer containing the entry CPZ
+*/
+static void addSmcUidLutIndexEntry(uint8_t slot, uint8_t userid, uint8_t* cpz)
+{
+    smc_uid_lut_used_slots[slot >> 3] |= (1 << (slot & 0x07));
+    smc_uid_lut_cpz_hashes[slot] = smcCpzHash(cpz);
+    smc_uid_lut_used_user_ids |= (1 << userid);
+}
+
+/*! \fn     smcUidLutIndexInit(void)
+*   \brief  Build the RAM index of the SMC CPZ <> user id LUT from the eeprom
+*/
+void smcUidLutIndexInit(void)
+{
+    uint8_t temp_buffer[SMARTCARD_CPZ_LENGTH];
+    uint16_t current_address;
+    uint8_t temp_userid;
+    
+    memset((void*)smc_uid_lut_used_slots, 0x00, sizeof(smc_uid_lut_used_slots));
+    smc_uid_lut_used_user_ids = 0;
+    
+    for (uint8_t i = 0; i < NB_MAX_SMCID_UID_MATCH_ENTRIES; i++)
+    {
+        current_address = smcUidLutAddress(i);
+        temp_userid = eeprom_read_byte((uint8_t*)current_address);
+        
+        if (temp_userid < NODE_MAX_UID)
+        {
+            eeprom_read_block(temp_buffer, (void*)(current_address + 1), SMARTCARD_CPZ_LENGTH);
+            addSmcUidLutIndexEntry(i, temp_userid, temp_buffer);
+        }
+    }
+}
 
 /*! \fn     mooltipassParametersInit(void)
 *   \brief  mooltipass parameters init
@@ -99,6 +181,9 @@ void firstTimeUserHandlingInit(void)
     {
         eeprom_write_byte((uint8_t*)(EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)i*SMCID_UID_MATCH_ENTRY_LENGTH), 0xFF);
     }
+    
+    // Empty the RAM index
+    smcUidLutIndexInit();
 }
 
 /*! \fn     controlEepromParameter(uint8_t val, uint8_t lowerBound, uint8_t upperBound)
@@ -162,17 +247,25 @@ void deleteUserIdFromSMCUIDLUT(uint8_t userid)
 {
     uint16_t temp_address;
     
-    // Browse through the LUT entries
+    // Check that the user has entries
+    if ((userid >= NODE_MAX_UID) || ((smc_uid_lut_used_user_ids & (1 << userid)) == 0))
+    {
+        return;
+    }
+    
+    // Browse through the used LUT entries
     for (uint8_t i = 0; i < NB_MAX_SMCID_UID_MATCH_ENTRIES; i++)
     {
-        temp_address = EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)i*SMCID_UID_MATCH_ENTRY_LENGTH;
+        temp_address = smcUidLutAddress(i);
         
         // If we find our userid, replace it with 0xFF
-        if (eeprom_read_byte((uint8_t*)(temp_address)) == userid)
+        if ((isSmcUidLutSlotUsed(i) != FALSE) && (eeprom_read_byte((uint8_t*)(temp_address)) == userid))
         {
             eeprom_write_byte((uint8_t*)(temp_address), 0xFF);
+            smc_uid_lut_used_slots[i >> 3] &= ~(1 << (i & 0x07));
         }
     }
+    smc_uid_lut_used_user_ids &= ~(1 << userid);
 }
 
 /*! \fn     findAvailableUserId(uint8_t* userid)
@@ -183,48 +276,21 @@ void deleteUserIdFromSMCUIDLUT(uint8_t userid)
 */
 RET_TYPE findAvailableUserId(uint8_t* userid, uint8_t* nb_users_free)
 {
-    uint8_t userIdArray[NODE_MAX_UID];
-    uint8_t temp_userid;
-    uint8_t i;
-    
-    // Set the user id array to false
-    memset(userIdArray, FALSE, NODE_MAX_UID);
+    RET_TYPE ret_val = RETURN_NOK;
     
-    // Browse through our LUT and find taken User IDs
-    for (i = 0; i < NB_MAX_SMCID_UID_MATCH_ENTRIES; i++)
-    {
-        // Read current user id
-        temp_userid = eeprom_read_byte((uint8_t*)(EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)i*SMCID_UID_MATCH_ENTRY_LENGTH));
-        
-        // Check if it is valid and then store it
-        if (temp_userid < NODE_MAX_UID)
-        {
-            userIdArray[temp_userid] = TRUE;
-        }
-    }
-
-    // Browse through the found user IDs and count number of free user slots
+    // Browse through the taken user IDs bitmap, count free user slots and report the first available one
     *nb_users_free = 0;
-    for (i = 0; i < NODE_MAX_UID; i++)
+    for (uint8_t i = NODE_MAX_UID; i-- > 0;)
     {
-        if (userIdArray[i] == FALSE)
+        if ((smc_uid_lut_used_user_ids & (1 << i)) == 0)
         {
             *nb_users_free = (*nb_users_free) + 1;
-        }
-    }
-    
-    // Browse through the found user IDs and report the first available one
-    for (i = 0; i < NODE_MAX_UID; i++)
-    {
-        if (userIdArray[i] == FALSE)
-        {
             *userid = i;
-            return RETURN_OK;
+            ret_val = RETURN_OK;
         }
     }
     
-    // Didn't find any available user ID
-    return RETURN_NOK;
+    return ret_val;
 }
 
 /*! \fn     findSmcUidLUTEmptySlot(uint16_t* found_address)
@@ -236,12 +302,10 @@ RET_TYPE findSmcUidLUTEmptySlot(uint16_t* found_address)
 {
     for (uint8_t i = 0; i < NB_MAX_SMCID_UID_MATCH_ENTRIES; i++)
     {
-        // Store current address
-        *found_address = EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)i*SMCID_UID_MATCH_ENTRY_LENGTH;
-        
-        // Check if user ID is above the max one
-        if (eeprom_read_byte((uint8_t*)(*found_address)) >= NODE_MAX_UID)
+        // Check the RAM index
+        if (isSmcUidLutSlotUsed(i) == FALSE)
         {
+            *found_address = smcUidLutAddress(i);
             return RETURN_OK;
         }
     }
@@ -258,11 +322,16 @@ void outputLUTEntriesForGivenUser(uint8_t userID)
     uint16_t current_address;
     uint8_t temp_userid;
     
-    // Loop through the Look Up Tables entries
+    // Loop through the used Look Up Tables entries
     for (uint8_t i = 0; i < NB_MAX_SMCID_UID_MATCH_ENTRIES; i++)
     {
+        if (isSmcUidLutSlotUsed(i) == FALSE)
+        {
+            continue;
+        }
+        
         // Current address var
-        current_address = EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)i*SMCID_UID_MATCH_ENTRY_LENGTH;
+        current_address = smcUidLutAddress(i);
         
         // Read this LUT entry user ID
         temp_userid = eeprom_read_byte((uint8_t*)current_address);
@@ -287,13 +356,20 @@ void outputLUTEntriesForGivenUser(uint8_t userID)
 RET_TYPE getUserIdFromSmartCardCPZ(uint8_t* buffer, uint8_t* nonce, uint8_t* userid)
 {
     uint8_t temp_buffer[SMARTCARD_CPZ_LENGTH];
+    uint8_t cpz_hash = smcCpzHash(buffer);
     uint16_t current_address;
     
     // Loop through the Look Up Tables entries
     for (uint8_t i = 0; i < NB_MAX_SMCID_UID_MATCH_ENTRIES; i++)
     {
+        // Only read the used entries whose CPZ hash matches
+        if ((isSmcUidLutSlotUsed(i) == FALSE) || (smc_uid_lut_cpz_hashes[i] != cpz_hash))
+        {
+            continue;
+        }
+        
         // Current address var
-        current_address = EEP_SMC_IC_USER_MATCH_START_ADDR + (uint16_t)i*SMCID_UID_MATCH_ENTRY_LENGTH;
+        current_address = smcUidLutAddress(i);
         
         // Read this LUT entry user ID
         *userid = eeprom_read_byte((uint8_t*)current_address);
@@ -337,6 +413,7 @@ RET_TYPE writeSmartCardCPZForUserId(uint8_t* buffer, uint8_t* nonce, uint8_t use
         eeprom_write_byte((uint8_t*)temp_address, userid);
         eeprom_write_block((void*)buffer, (void*)(temp_address + 1), SMARTCARD_CPZ_LENGTH);
         eeprom_write_block((void*)nonce, (void*)(temp_address + 1 + SMARTCARD_CPZ_LENGTH), AES256_CTR_LENGTH);
+        addSmcUidLutIndexEntry((temp_address - EEP_SMC_IC_USER_MATCH_START_ADDR) / SMCID_UID_MATCH_ENTRY_LENGTH, userid, buffer);
         
         // Return success!
         return RETURN_OK;
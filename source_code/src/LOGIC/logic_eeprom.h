@@ -92,6 +92,7 @@ uint8_t getMooltipassParameterInEeprom(uint8_t param);
 void outputLUTEntriesForGivenUser(uint8_t userID);
 void deleteUserIdFromSMCUIDLUT(uint8_t userid);
 void firstTimeUserHandlingInit(void);
+void smcUidLutIndexInit(void);
 void mooltipassParametersInit(void);
 
 #endif /* LOGIC_EEPROM_H_ */
\ No newline at end of file
@@ -207,6 +207,10 @@ void handleSmartcardRemoved(void)
     removeFunctionSMC();
     clearSmartCardInsertedUnlocked();
 
+    // Write the pending last used dates and the allocation cursor
+    flushUsedChildNodesDates();
+    saveNodeAllocationCursor();
+
     // Clear encryption context
     memset((void*)temp_buffer, 0, AES_KEY_LENGTH/8);
     memset((void*)temp_ctr_val, 0, AES256_CTR_LENGTH);
@@ -38,6 +38,26 @@
 mgmtHandle currentNodeMgmtHandle;
 // Current date
 uint16_t currentDate;
+// Child nodes whose last used date needs to be updated
+uint16_t usedChildNodesQueue[NODE_USED_QUEUE_SIZE];
+// Number of child nodes in the queue
+uint8_t usedChildNodesQueueCount = 0;
+// Page currently staged in the flash buffer 1 by a node write batch
+uint16_t nodeWriteBatchPage = NODE_WRITE_BATCH_NO_PAGE;
+// Node write batch nesting level
+uint8_t nodeWriteBatchDepth = 0;
+// Set when the current node write batch is journaled
+uint8_t nodeJournalActive = FALSE;
+// Pages whose images are stored in the journal
+uint16_t nodeJournalPages[NODE_JOURNAL_MAX_PAGES];
+// Number of pages in the journal
+uint8_t nodeJournalCount = 0;
+// Journal slot used by the next journaled batch
+uint8_t nodeJournalSlot = 0;
+// Sequence number of the next journaled batch
+uint16_t nodeJournalSequence = 0;
+// End of the pages that may hold nodes: the journal sector is only used once it doesn't hold nodes written by a previous firmware
+uint16_t nodeAreaPageEnd = FLASH_PAGE_COUNT;
 
 
 /*! \fn     nodeMgmtCriticalErrorCallback(void)
@@ -195,6 +215,213 @@ RET_TYPE extractDate(uint16_t date, uint8_t *year, uint8_t *month, uint8_t *day)
     return RETURN_OK;
 }
 
+/*! \fn     nodeJournalSourcePage(uint16_t page)
+*   \brief  Get the page holding the current contents of a given page, which may be a journal image
+*   \param  page    Page number
+*   \return The journal image page if the page is journaled, the page otherwise
+*/
+static uint16_t nodeJournalSourcePage(uint16_t page)
+{
+    for (uint8_t i = 0; i < nodeJournalCount; i++)
+    {
+        if (nodeJournalPages[i] == page)
+        {
+            return NODE_JOURNAL_FIRST_PAGE + NODE_JOURNAL_SLOT_PAGES*nodeJournalSlot + 1 + i;
+        }
+    }
+    return page;
+}
+
+/*! \fn     writeNodeJournalHeader(uint8_t count)
+*   \brief  Write the header of the current journal slot
+*   \param  count   Number of journaled pages, 0 to mark them as copied
+*/
+static void writeNodeJournalHeader(uint8_t count)
+{
+    nodeJournalHeader header;
+
+    header.magic = NODE_JOURNAL_MAGIC;
+    header.sequence = nodeJournalSequence;
+    header.count = count;
+    memcpy((void*)header.pages, (void*)nodeJournalPages, sizeof(header.pages));
+    header.crc = crc32_update(0, (uint8_t*)&header, offsetof(nodeJournalHeader, crc));
+    writeDataToFlash(NODE_JOURNAL_FIRST_PAGE + NODE_JOURNAL_SLOT_PAGES*nodeJournalSlot, 0, sizeof(header), (void*)&header);
+}
+
+/*! \fn     replayNodeJournal(void)
+*   \brief  Copy the journaled page images of the current slot to their pages, then move to the next slot
+*   \note   Copies are done inside the flash chip and can be replayed as many times as needed
+*/
+static void replayNodeJournal(void)
+{
+    for (uint8_t i = 0; i < nodeJournalCount; i++)
+    {
+        loadPageToInternalBuffer1(NODE_JOURNAL_FIRST_PAGE + NODE_JOURNAL_SLOT_PAGES*nodeJournalSlot + 1 + i);
+        flashWriteBuffer1ToPage(nodeJournalPages[i]);
+    }
+    writeNodeJournalHeader(0);
+    nodeJournalCount = 0;
+    nodeJournalSequence++;
+    if (++nodeJournalSlot == NODE_JOURNAL_NB_SLOTS)
+    {
+        nodeJournalSlot = 0;
+    }
+}
+
+/*! \fn     applyNodeJournal(void)
+*   \brief  Commit the journal and copy its page images to their pages
+*/
+static void applyNodeJournal(void)
+{
+    if (nodeJournalCount == 0)
+    {
+        return;
+    }
+
+    // Once the header is written the mutation will complete, even after a power loss
+    writeNodeJournalHeader(nodeJournalCount);
+    replayNodeJournal();
+}
+
+/*! \fn     recoverNodeJournal(void)
+*   \brief  Complete a journaled node mutation interrupted by a power loss, find the next journal slot
+*   \note   Called at boot. Without any journal header, the journal sector is claimed if it doesn't hold any node
+*/
+void recoverNodeJournal(void)
+{
+    nodeJournalHeader header;
+    uint8_t last_slot = NODE_JOURNAL_NB_SLOTS;
+    uint8_t last_count = 0;
+    uint16_t flags;
+
+    #if (NODE_JOURNAL_NB_SLOTS == 0) || (NODE_JOURNAL_FIRST_PAGE <= GRAPHIC_ZONE_PAGE_END)
+        #error "No room for the node journal sector"
+    #endif
+
+    // Find the last used slot: the valid header with the highest sequence number
+    for (uint8_t slot = 0; slot < NODE_JOURNAL_NB_SLOTS; slot++)
+    {
+        readDataFromFlash(NODE_JOURNAL_FIRST_PAGE + NODE_JOURNAL_SLOT_PAGES*slot, 0, sizeof(header), (void*)&header);
+        if ((header.magic != NODE_JOURNAL_MAGIC) || (header.count > NODE_JOURNAL_MAX_PAGES) || (header.crc != crc32_update(0, (uint8_t*)&header, offsetof(nodeJournalHeader, crc))))
+        {
+            continue;
+        }
+        if ((last_slot == NODE_JOURNAL_NB_SLOTS) || ((int16_t)(header.sequence - nodeJournalSequence) > 0))
+        {
+            last_slot = slot;
+            last_count = header.count;
+            nodeJournalSequence = header.sequence;
+            memcpy((void*)nodeJournalPages, (void*)header.pages, sizeof(header.pages));
+        }
+    }
+
+    if (last_slot == NODE_JOURNAL_NB_SLOTS)
+    {
+        // Never used: the journal sector may hold nodes written by a previous firmware, the journal stays off until they're deleted
+        for (uint16_t pageItr = NODE_JOURNAL_FIRST_PAGE; pageItr < FLASH_PAGE_COUNT; pageItr++)
+        {
+            for (uint8_t nodeItr = 0; nodeItr < (FLASH_BYTES_PER_PAGE / NODE_SIZE); nodeItr++)
+            {
+                readDataFromFlash(pageItr, NODE_SIZE*nodeItr, 2, (void*)&flags);
+                if (validBitFromFlags(flags) == NODE_VBIT_VALID)
+                {
+                    return;
+                }
+            }
+        }
+
+        // Claim it with an empty header
+        nodeJournalSlot = 0;
+        nodeJournalSequence = 0;
+        writeNodeJournalHeader(0);
+        last_slot = 0;
+    }
+    nodeAreaPageEnd = NODE_JOURNAL_FIRST_PAGE;
+    nodeJournalSlot = last_slot;
+
+    // Only replay images targeting the user profiles or the nodes area
+    nodeJournalCount = last_count;
+    for (uint8_t i = 0; i < nodeJournalCount; i++)
+    {
+        if (((nodeJournalPages[i] >= USER_PROFILES_PAGE_END) && (nodeJournalPages[i] < GRAPHIC_ZONE_PAGE_END)) || (nodeJournalPages[i] >= NODE_JOURNAL_FIRST_PAGE))
+        {
+            nodeJournalCount = 0;
+        }
+    }
+    if (nodeJournalCount != 0)
+    {
+        replayNodeJournal();
+    }
+    else
+    {
+        // Next batch uses the following slot
+        nodeJournalSequence++;
+        if (++nodeJournalSlot == NODE_JOURNAL_NB_SLOTS)
+        {
+            nodeJournalSlot = 0;
+        }
+    }
+}
+
+/*! \fn     readNodeBytesFromFlash(uint16_t page, uint16_t offset, uint16_t size, void* data)
+*   \brief  Read node bytes from flash, or from the flash buffer if their page is staged by a write batch
+*   \param  page    Page number
+*   \param  offset  Offset inside the page
+*   \param  size    Number of bytes to read
+*   \param  data    Pointer to the data
+*/
+static void readNodeBytesFromFlash(uint16_t page, uint16_t offset, uint16_t size, void* data)
+{
+    if (page == nodeWriteBatchPage)
+    {
+        flashReadBuffer1(data, offset, size);
+    }
+    else
+    {
+        readDataFromFlash(nodeJournalSourcePage(page), offset, size, data);
+    }
+}
+
+/*! \fn     programNodeWriteBatchPage(void)
+*   \brief  Program the page staged in the flash buffer 1, if any
+*/
+static void programNodeWriteBatchPage(void)
+{
+    if (nodeWriteBatchPage != NODE_WRITE_BATCH_NO_PAGE)
+    {
+        flashWriteBuffer1ToPage(nodeJournalSourcePage(nodeWriteBatchPage));
+        nodeWriteBatchPage = NODE_WRITE_BATCH_NO_PAGE;
+    }
+}
+
+/*! \fn     startNodeWriteBatch(uint8_t journal)
+*   \brief  Start staging the node writes in the flash buffer 1, so that consecutive writes to a same page only program it once
+*   \param  journal TRUE to make the writes of the batch atomic using the node journal, only used for the outermost batch
+*   \note   Batches can be nested, only node read/write functions may access the flash until commitNodeWriteBatch() is called
+*   \note   A journaled batch must modify at most NODE_JOURNAL_MAX_PAGES pages
+*   \note   Batches aren't journaled while the journal sector holds nodes written by a previous firmware
+*/
+void startNodeWriteBatch(uint8_t journal)
+{
+    if (nodeWriteBatchDepth++ == 0)
+    {
+        nodeJournalActive = (nodeAreaPageEnd == NODE_JOURNAL_FIRST_PAGE) ? journal : FALSE;
+    }
+}
+
+/*! \fn     commitNodeWriteBatch(void)
+*   \brief  End a node write batch, programming the staged page when leaving the outermost batch
+*/
+void commitNodeWriteBatch(void)
+{
+    if (--nodeWriteBatchDepth == 0)
+    {
+        programNodeWriteBatchPage();
+        applyNodeJournal();
+        nodeJournalActive = FALSE;
+    }
+}
+
 /*! \fn     checkUserPermission(uint16_t node_addr)
 *   \brief  Check that the user has the right to read/write a node
 *   \param  node_addr   Node address
@@ -210,10 +437,12 @@ RET_TYPE checkUserPermission(uint16_t node_addr)
     uint16_t byte_addr = NODE_SIZE * (uint16_t)nodeNumberFromAddress(node_addr);
 
     // Fetch the flags
-    readDataFromFlash(page_addr, byte_addr, 2, (void*)&temp_flags);
+    readNodeBytesFromFlash(page_addr, byte_addr, 2, (void*)&temp_flags);
 
     // Either the node belongs to us or it is invalid, check that the address is after sector 1 (upper check done at the flashread/write level)
-    if(((getCurrentUserID() == userIdFromFlags(temp_flags)) || (validBitFromFlags(temp_flags) == NODE_VBIT_INVALID)) && (page_addr >= GRAPHIC_ZONE_PAGE_END))
+    // Only our nodes written by a previous firmware are accessible in the journal sector, until it is claimed
+    if(((getCurrentUserID() == userIdFromFlags(temp_flags)) || (validBitFromFlags(temp_flags) == NODE_VBIT_INVALID)) && (page_addr >= GRAPHIC_ZONE_PAGE_END)
+        && ((page_addr < NODE_JOURNAL_FIRST_PAGE) || ((page_addr < nodeAreaPageEnd) && (validBitFromFlags(temp_flags) == NODE_VBIT_VALID))))
     {
         return RETURN_OK;
     }
@@ -223,6 +452,44 @@ RET_TYPE checkUserPermission(uint16_t node_addr)
     }
 }
 
+/*! \fn     writeNodeBytesToFlash(uint16_t page_addr, uint16_t offset, uint16_t size, void* data)
+*   \brief  Write node or user profile bytes to flash, or stage them in the flash buffer if a write batch is started
+*   \param  page_addr   Page number
+*   \param  offset      Offset inside the page
+*   \param  size        Number of bytes to write
+*   \param  data        Pointer to the data
+*/
+static void writeNodeBytesToFlash(uint16_t page_addr, uint16_t offset, uint16_t size, void* data)
+{
+    if (nodeWriteBatchDepth == 0)
+    {
+        writeDataToFlash(page_addr, offset, size, data);
+    }
+    else
+    {
+        // Stage the node page in the flash buffer, programming the previous one
+        if (page_addr != nodeWriteBatchPage)
+        {
+            programNodeWriteBatchPage();
+            uint16_t source_page = nodeJournalSourcePage(page_addr);
+
+            // Journaled batch: the page will be programmed in the journal until the batch is committed
+            if ((nodeJournalActive != FALSE) && (source_page == page_addr))
+            {
+                // Journaled mutations are sized to fit, applying a partial journal would break their atomicity
+                if (nodeJournalCount == NODE_JOURNAL_MAX_PAGES)
+                {
+                    nodeMgmtCriticalErrorCallback();
+                }
+                nodeJournalPages[nodeJournalCount++] = page_addr;
+            }
+            loadPageToInternalBuffer1(source_page);
+            nodeWriteBatchPage = page_addr;
+        }
+        flashWriteBuffer1(data, offset, size);
+    }
+}
+
 /*! \fn     writeNodeDataBlockToFlash(uint16_t address, void* data)
 *   \brief  Write a node data block to flash
 *   \param  address Where to write
@@ -230,7 +497,7 @@ RET_TYPE checkUserPermission(uint16_t node_addr)
 */
 void writeNodeDataBlockToFlash(uint16_t address, void* data)
 {
-    writeDataToFlash(pageNumberFromAddress(address), NODE_SIZE * nodeNumberFromAddress(address), NODE_SIZE, data);
+    writeNodeBytesToFlash(pageNumberFromAddress(address), NODE_SIZE * nodeNumberFromAddress(address), NODE_SIZE, data);
 }
 
 /*! \fn     readNodeDataBlockFromFlash(uint16_t address, void* data)
@@ -240,7 +507,7 @@ void writeNodeDataBlockToFlash(uint16_t address, void* data)
 */
 void readNodeDataBlockFromFlash(uint16_t address, void* data)
 {
-    readDataFromFlash(pageNumberFromAddress(address), NODE_SIZE * nodeNumberFromAddress(address), NODE_SIZE, data);
+    readNodeBytesFromFlash(pageNumberFromAddress(address), NODE_SIZE * nodeNumberFromAddress(address), NODE_SIZE, data);
 }
 
 /*! \fn     eraseNodeDataBlockToFlash(uint16_t address)
@@ -253,7 +520,7 @@ void eraseNodeDataBlockToFlash(uint16_t address)
 
     // Set data to 0xFF
     memset(data, 0xFF, NODE_SIZE);
-    writeDataToFlash(pageNumberFromAddress(address), NODE_SIZE * nodeNumberFromAddress(address), NODE_SIZE, data);
+    writeNodeDataBlockToFlash(address, data);
 }
 
 /**
@@ -298,6 +565,25 @@ void formatUserProfileMemory(uint8_t uid)
     memset(buf, 0, USER_PROFILE_SIZE);
     userProfileStartingOffset(uid, &temp_page, &temp_offset);
     writeDataToFlash(temp_page, temp_offset, USER_PROFILE_SIZE, buf);
+
+    // Keep the cached profile in sync if it is the one we formatted
+    if ((temp_page == currentNodeMgmtHandle.pageUserProfile) && (temp_offset == currentNodeMgmtHandle.offsetUserProfile))
+    {
+        memset(&currentNodeMgmtHandle.profile, 0, USER_PROFILE_SIZE);
+    }
+}
+
+/**
+ * Writes a field of the cached user profile to the user profile memory portion of flash
+ * @param   field           Pointer to the field inside currentNodeMgmtHandle.profile
+ * @param   size            The size of the field
+ * @note    Inside a journaled write batch, the user profile page is journaled with the nodes
+ */
+static void writeUserProfileField(void* field, uint8_t size)
+{
+    uint8_t field_offset = (uint8_t)((uint8_t*)field - (uint8_t*)&currentNodeMgmtHandle.profile);
+
+    writeNodeBytesToFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + field_offset, size, field);
 }
 
 /*! \fn     getCurrentUserID(void)
@@ -330,15 +616,22 @@ void initNodeManagementHandle(uint8_t userIdNum)
         nodeMgmtPermissionValidityErrorCallback();
     }
 
+    // write the pending last used dates and the allocation cursor of the previous user
+    flushUsedChildNodesDates();
+    saveNodeAllocationCursor();
+
     // fill current user id, first parent node address, user profile page & offset
     userProfileStartingOffset(userIdNum, &currentNodeMgmtHandle.pageUserProfile, &currentNodeMgmtHandle.offsetUserProfile);
+
+    // load the whole user profile, it is then served from RAM and written through
+    readDataFromFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile, USER_PROFILE_SIZE, &currentNodeMgmtHandle.profile);
     currentNodeMgmtHandle.firstDataParentNode = getStartingDataParentAddress();
     currentNodeMgmtHandle.firstParentNode = getStartingParentAddress();
     currentNodeMgmtHandle.currentUserId = userIdNum;
     currentNodeMgmtHandle.dbChanged = FALSE;
 
-    // scan for next free parent and child nodes from the start of the memory
-    if (findFreeNodes(1, &currentNodeMgmtHandle.nextFreeNode, 0, 0) == 0)
+    // scan for next free parent and child nodes from where the last session stopped allocating
+    if (findFreeNodesFromAddress(1, &currentNodeMgmtHandle.nextFreeNode, getNodeAllocationCursor()) == 0)
     {
         currentNodeMgmtHandle.nextFreeNode = NODE_ADDR_NULL;
     }
@@ -381,8 +674,9 @@ void setStartingParent(uint16_t parentAddress)
     // update handle
     currentNodeMgmtHandle.firstParentNode = parentAddress;
 
-    // Write parentaddress in the user profile page
-    writeDataToFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile, 2, &parentAddress);
+    // Write parentaddress in the user profile
+    currentNodeMgmtHandle.profile.startingParent = parentAddress;
+    writeUserProfileField(&currentNodeMgmtHandle.profile.startingParent, sizeof(currentNodeMgmtHandle.profile.startingParent));
 }
 
 /**
@@ -394,45 +688,56 @@ void setDataStartingParent(uint16_t dataParentAddress)
     // update handle
     currentNodeMgmtHandle.firstDataParentNode = dataParentAddress;
 
-    // Write data parent address in the user profile page
-    writeDataToFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + (USER_MAX_FAV * USER_FAV_SIZE) + USER_START_NODE_SIZE, 2, &dataParentAddress);
+    // Write data parent address in the user profile
+    currentNodeMgmtHandle.profile.dataStartingParent = dataParentAddress;
+    writeUserProfileField(&currentNodeMgmtHandle.profile.dataStartingParent, sizeof(currentNodeMgmtHandle.profile.dataStartingParent));
 }
 
 /**
- * Gets the users starting parent node from the user profile memory portion of flash
+ * Gets the node address from which the users free node search starts, from the cached user profile
  * @return  The address
  */
-uint16_t getStartingParentAddress(void)
+uint16_t getNodeAllocationCursor(void)
 {
-    uint16_t temp_address;
+    return currentNodeMgmtHandle.profile.allocationCursor;
+}
+
+/**
+ * Stores the users next free node in the user profile memory portion of flash, so the next session keeps allocating from there
+ * @note    Only written when it changed, to not wear the user profile page
+ * @note    Called at the end of a user session, nothing is written until the next initNodeManagementHandle
+ */
+void saveNodeAllocationCursor(void)
+{
+    uint16_t temp_address = currentNodeMgmtHandle.nextFreeNode;
 
-    // restore parentAddress
-    readDataFromFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile, 2, &temp_address);
+    // NODE_ADDR_NULL when no user is logged in or the user was deleted
+    if ((temp_address != NODE_ADDR_NULL) && (temp_address != getNodeAllocationCursor()))
+    {
+        currentNodeMgmtHandle.profile.allocationCursor = temp_address;
+        writeUserProfileField(&currentNodeMgmtHandle.profile.allocationCursor, sizeof(currentNodeMgmtHandle.profile.allocationCursor));
+    }
 
-    return temp_address;
+    // Session is over, don't save it again
+    currentNodeMgmtHandle.nextFreeNode = NODE_ADDR_NULL;
 }
 
 /**
- * Gets the users last parent node from the node management handle
+ * Gets the users starting parent node from the cached user profile
  * @return  The address
  */
-uint16_t getLastParentAddress(void)
+uint16_t getStartingParentAddress(void)
 {
-    return currentNodeMgmtHandle.lastParentNode;
+    return currentNodeMgmtHandle.profile.startingParent;
 }
 
 /**
- * Gets the users starting data parent node from the user profile memory portion of flash
+ * Gets the users starting data parent node from the cached user profile
  * @return  The address
  */
 uint16_t getStartingDataParentAddress(void)
 {
-    uint16_t temp_address;
-
-    // Each user profile is within a page, data starting parent node is at the end of the favorites
-    readDataFromFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + (USER_MAX_FAV * USER_FAV_SIZE) + USER_START_NODE_SIZE, 2, &temp_address);
-
-    return temp_address;
+    return currentNodeMgmtHandle.profile.dataStartingParent;
 }
 
 /**
@@ -443,15 +748,21 @@ uint16_t getStartingDataParentAddress(void)
  */
 void setFav(uint8_t favId, uint16_t parentAddress, uint16_t childAddress)
 {
-    uint16_t addrs[2] = {parentAddress, childAddress};
-
     if(favId >= USER_MAX_FAV)
     {
         nodeMgmtCriticalErrorCallback();
     }
 
-    // write to flash, each fav is 4 bytes. +2 for starting parent node offset
-    writeDataToFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + (favId * USER_FAV_SIZE) + USER_START_NODE_SIZE, USER_FAV_SIZE, (void *)addrs);
+    // Skip the flash write if the favorite didn't change
+    if ((currentNodeMgmtHandle.profile.favorites[favId][0] == parentAddress) && (currentNodeMgmtHandle.profile.favorites[favId][1] == childAddress))
+    {
+        return;
+    }
+
+    // update the cached profile & write to flash, each fav is 4 bytes
+    currentNodeMgmtHandle.profile.favorites[favId][0] = parentAddress;
+    currentNodeMgmtHandle.profile.favorites[favId][1] = childAddress;
+    writeUserProfileField(currentNodeMgmtHandle.profile.favorites[favId], USER_FAV_SIZE);
 }
 
 /**
@@ -462,24 +773,33 @@ void setFav(uint8_t favId, uint16_t parentAddress, uint16_t childAddress)
  */
 void readFav(uint8_t favId, uint16_t* parentAddress, uint16_t* childAddress)
 {
-    uint16_t temp_uint;
-    uint16_t addrs[2];
+    uint16_t temp_flags;
+    uint8_t fav_valid = FALSE;
 
     if(favId >= USER_MAX_FAV)
     {
         nodeMgmtCriticalErrorCallback();
     }
 
-    // Read from flash
-    readDataFromFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + (favId * USER_FAV_SIZE) + USER_START_NODE_SIZE, USER_FAV_SIZE, (void *)addrs);
+    // return values from the cached profile
+    *parentAddress = currentNodeMgmtHandle.profile.favorites[favId][0];
+    *childAddress = currentNodeMgmtHandle.profile.favorites[favId][1];
 
-    // return values to user
-    *parentAddress = addrs[0];
-    *childAddress = addrs[1];
+    if (*childAddress == NODE_ADDR_NULL)
+    {
+        return;
+    }
 
-    // Check valid bit flag
-    readDataFromFlash(pageNumberFromAddress(*childAddress), NODE_SIZE * nodeNumberFromAddress(*childAddress), 2, &temp_uint);
-    if (((validBitFromFlags(temp_uint) == NODE_VBIT_INVALID) || (checkUserPermission(*childAddress) != RETURN_OK)) && (*childAddress != NODE_ADDR_NULL))
+    // Check that the child address is a node slot, then that the node is still valid and ours, with a single flags read
+    if ((pageNumberFromAddress(*childAddress) >= GRAPHIC_ZONE_PAGE_END) && (pageNumberFromAddress(*childAddress) < nodeAreaPageEnd) && (nodeNumberFromAddress(*childAddress) < (FLASH_BYTES_PER_PAGE / NODE_SIZE)))
+    {
+        readNodeBytesFromFlash(pageNumberFromAddress(*childAddress), NODE_SIZE * nodeNumberFromAddress(*childAddress), 2, &temp_flags);
+        if ((validBitFromFlags(temp_flags) == NODE_VBIT_VALID) && (userIdFromFlags(temp_flags) == getCurrentUserID()))
+        {
+            fav_valid = TRUE;
+        }
+    }
+    if (fav_valid == FALSE)
     {
         // Delete fav and return node_addr_null
         setFav(favId, NODE_ADDR_NULL, NODE_ADDR_NULL);
@@ -489,43 +809,43 @@ void readFav(uint8_t favId, uint16_t* parentAddress, uint16_t* childAddress)
 }
 
 /**
- * Sets the users base CTR in the user profile flash memory
+ * Sets the users base CTR in the cached user profile and its flash memory
  * @param   buf             The buffer containing CTR
  */
 void setProfileCtr(void *buf)
 {
     // User CTR is at the end
-    writeDataToFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + USER_PROFILE_SIZE - USER_RES_CTR, USER_CTR_SIZE, buf);
+    memcpy(currentNodeMgmtHandle.profile.ctr, buf, USER_CTR_SIZE);
+    writeUserProfileField(currentNodeMgmtHandle.profile.ctr, USER_CTR_SIZE);
 }
 
 /**
- * Reads the users base CTR from the user profile flash memory
+ * Reads the users base CTR from the cached user profile
  * @param   buf             The buffer to store the read CTR
  */
 void readProfileCtr(void *buf)
 {
-    // User CTR is at the end
-    readDataFromFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + USER_PROFILE_SIZE - USER_RES_CTR, USER_CTR_SIZE, buf);
+    memcpy(buf, currentNodeMgmtHandle.profile.ctr, USER_CTR_SIZE);
 }
 
 /**
- * Sets the user DB change number in the user profile flash memory
+ * Sets the user DB change number in the cached user profile and its flash memory
  * @param   buf             The buffer containing the user db change number
  */
 void setProfileUserDbChangeNumber(void *buf)
 {
-    // User CTR is at the end
-    writeDataToFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + USER_PROFILE_SIZE - USER_DB_CHANGE_NB_SIZE, USER_DB_CHANGE_NB_SIZE, buf);
+    // User DB change number is the last byte
+    currentNodeMgmtHandle.profile.dbChangeNumber = *(uint8_t*)buf;
+    writeUserProfileField(&currentNodeMgmtHandle.profile.dbChangeNumber, USER_DB_CHANGE_NB_SIZE);
 }
 
 /**
- * Reads the user DB change number
+ * Reads the user DB change number from the cached user profile
  * @param   buf             The buffer to store the user db change number
  */
 void readProfileUserDbChangeNumber(void *buf)
 {
-    // User CTR is at the end
-    readDataFromFlash(currentNodeMgmtHandle.pageUserProfile, currentNodeMgmtHandle.offsetUserProfile + USER_PROFILE_SIZE - USER_DB_CHANGE_NB_SIZE, USER_DB_CHANGE_NB_SIZE, buf);
+    *(uint8_t*)buf = currentNodeMgmtHandle.profile.dbChangeNumber;
 }
 
 /**
@@ -564,18 +884,85 @@ void readParentNode(pNode* p, uint16_t parentNodeAddress)
 void readChildNode(cNode *c, uint16_t childNodeAddress)
 {
     readNode((gNode*)c, childNodeAddress);
+    c->description[sizeof(c->description)-1] = 0;
+    c->login[sizeof(c->login)-1] = 0;
+}
 
-    // If we have a date, update last used field
-    if (currentDate != 0x0000)
+/**
+ * Removes a child node from the queue of nodes waiting for their last used date update
+ * @param   childNodeAddress    The address of the child node
+ */
+static void removeChildNodeFromUsedQueue(uint16_t childNodeAddress)
+{
+    for (uint8_t i = 0; i < usedChildNodesQueueCount; i++)
     {
-        // Just update the good field and write at the same place, write is destructive!
-        c->dateLastUsed = currentDate;
-        writeNodeDataBlockToFlash(childNodeAddress, c);
-        readNode((gNode*)c, childNodeAddress);
+        if (usedChildNodesQueue[i] == childNodeAddress)
+        {
+            usedChildNodesQueue[i] = usedChildNodesQueue[--usedChildNodesQueueCount];
+            return;
+        }
+    }
+}
+
+/**
+ * Records that a child node was used, its last used date will be written by flushUsedChildNodesDates()
+ * @param   childNodeAddress    The address of the child node
+ * @note    The queue is flushed when full
+ */
+void markChildNodeAsUsed(uint16_t childNodeAddress)
+{
+    // No date set, nothing to record
+    if (currentDate == 0x0000)
+    {
+        return;
     }
 
-    c->description[sizeof(c->description)-1] = 0;
-    c->login[sizeof(c->login)-1] = 0;
+    // Check if the node is already queued
+    for (uint8_t i = 0; i < usedChildNodesQueueCount; i++)
+    {
+        if (usedChildNodesQueue[i] == childNodeAddress)
+        {
+            return;
+        }
+    }
+
+    if (usedChildNodesQueueCount == NODE_USED_QUEUE_SIZE)
+    {
+        flushUsedChildNodesDates();
+    }
+    usedChildNodesQueue[usedChildNodesQueueCount++] = childNodeAddress;
+}
+
+/**
+ * Writes the last used date of the queued child nodes
+ * @note    Only the date field is written, and only when it differs from the current date
+ * @note    Nodes that aren't valid child nodes of the current user anymore are skipped
+ */
+void flushUsedChildNodesDates(void)
+{
+    uint16_t temp_flags, temp_date;
+    uint16_t page_addr, byte_addr;
+
+    for (uint8_t i = 0; i < usedChildNodesQueueCount; i++)
+    {
+        page_addr = pageNumberFromAddress(usedChildNodesQueue[i]);
+        byte_addr = NODE_SIZE * (uint16_t)nodeNumberFromAddress(usedChildNodesQueue[i]);
+
+        // Check that the node is still one of our child nodes
+        readDataFromFlash(page_addr, byte_addr, sizeof(temp_flags), (void*)&temp_flags);
+        if ((page_addr < GRAPHIC_ZONE_PAGE_END) || (validBitFromFlags(temp_flags) != NODE_VBIT_VALID) || (userIdFromFlags(temp_flags) != getCurrentUserID()) || (nodeTypeFromFlags(temp_flags) != NODE_TYPE_CHILD))
+        {
+            continue;
+        }
+
+        // Only write the date field if it changed
+        readDataFromFlash(page_addr, byte_addr + offsetof(cNode, dateLastUsed), sizeof(temp_date), (void*)&temp_date);
+        if (temp_date != currentDate)
+        {
+            writeDataToFlash(page_addr, byte_addr + offsetof(cNode, dateLastUsed), sizeof(currentDate), (void*)&currentDate);
+        }
+    }
+    usedChildNodesQueueCount = 0;
 }
 
 /**
@@ -612,7 +999,8 @@ RET_TYPE createParentNode(pNode* p, uint8_t type)
         nodeTypeToFlags(&(p->flags), NODE_TYPE_PARENT_DATA);
     }
 
-    // Call createGenericNode to add a node
+    // Call createGenericNode to add a node, a new first node address is journaled with it
+    startNodeWriteBatch(TRUE);
     temprettype = createGenericNode((gNode*)p, first_parent_addr, &temp_address, PNODE_COMPARISON_FIELD_OFFSET, NODE_PARENT_SIZE_OF_SERVICE);
 
     // If the return is ok & we changed the first node address
@@ -627,6 +1015,7 @@ RET_TYPE createParentNode(pNode* p, uint8_t type)
             setDataStartingParent(temp_address);
         }
     }
+    commitNodeWriteBatch();
 
     // Populate services LUT
     populateServicesLut();
@@ -658,7 +1047,8 @@ RET_TYPE createChildNode(uint16_t pAddr, cNode *c)
     readNode((gNode*)tempPNodePointer, pAddr);
     childFirstAddress = tempPNodePointer->nextChildAddress;
 
-    // Call createGenericNode to add a node
+    // Call createGenericNode to add a node, the parent update is batched with it
+    startNodeWriteBatch(TRUE);
     temprettype = createGenericNode((gNode*)c, childFirstAddress, &temp_address, CNODE_COMPARISON_FIELD_OFFSET, NODE_CHILD_SIZE_OF_LOGIN);
 
     // If the return is ok & we changed the first child address
@@ -668,6 +1058,7 @@ RET_TYPE createChildNode(uint16_t pAddr, cNode *c)
        tempPNodePointer->nextChildAddress = temp_address;
        writeNodeDataBlockToFlash(pAddr, tempPNodePointer);
     }
+    commitNodeWriteBatch();
 
     return temprettype;
 }
@@ -688,7 +1079,7 @@ RET_TYPE writeNewDataNode(uint16_t context_parent_node_addr, pNode* parent_node_
     uint16_t next_free_addresses[2];
 
     // This is what scan node usage uses internally, check space in flash
-    if (findFreeNodes(2, next_free_addresses, 0, 0) != 2)
+    if (findFreeNodesFromAddress(2, next_free_addresses, currentNodeMgmtHandle.nextFreeNode) != 2)
     {
         return RETURN_NOK;
     }
@@ -771,6 +1162,9 @@ RET_TYPE createGenericNode(gNode* g, uint16_t firstNodeAddress, uint16_t* newFir
     g->prevAddress = NODE_ADDR_NULL;
     g->nextAddress = NODE_ADDR_NULL;
 
+    // new node and its neighbours often share pages, the mutation is journaled
+    startNodeWriteBatch(TRUE);
+
     // if user has no nodes. this node is the first node
     if(firstNodeAddress == NODE_ADDR_NULL)
     {
@@ -863,83 +1257,300 @@ RET_TYPE createGenericNode(gNode* g, uint16_t firstNodeAddress, uint16_t* newFir
             {
                 // services match
                 // return nok. Same parent node
+                commitNodeWriteBatch();
                 return RETURN_NOK;
             } // end cmp results
         } // end while
     } // end if first parent
 
+    commitNodeWriteBatch();
     scanNodeUsage();
 
     return RETURN_OK;
 }
 
-/*! \fn     populateServicesLut(void)
-*   \brief  Populate our LUT for our services
+/*! \fn     setChildListHead(uint16_t parentAddress, uint16_t childAddress)
+*   \brief  Set the first child address of a parent node
+*   \param  parentAddress   Parent node address
+*   \param  childAddress    New first child address
 */
-void populateServicesLut(void)
+static void setChildListHead(uint16_t parentAddress, uint16_t childAddress)
 {
-    uint16_t next_node_addr = currentNodeMgmtHandle.firstParentNode;
-    uint8_t temp_node_buffer[9];
-    uint16_t temp_page_number;
-    pNode* pnode_ptr = (pNode*)temp_node_buffer;
-    uint8_t first_service_letter;
+    pNode* ip = (pNode*)&(currentNodeMgmtHandle.tempgNode);
 
-    // Empty our current services list
-    memset(currentNodeMgmtHandle.servicesLut, 0x00, sizeof(currentNodeMgmtHandle.servicesLut));
+    readParentNode(ip, parentAddress);
+    ip->nextChildAddress = childAddress;
+    writeNodeDataBlockToFlash(parentAddress, ip);
+}
 
-    // If the dedicated boolean in eeprom is sent, do not actually populate the LUT
-    if (getMooltipassParameterInEeprom(LUT_BOOT_POPULATING_PARAM) == FALSE)
+/*! \fn     setParentListHead(uint16_t flags, uint16_t parentAddress)
+*   \brief  Set the starting parent of a parent node list in the user profile
+*   \param  flags           Flags of a node of the list, to know its type
+*   \param  parentAddress   New starting parent address
+*/
+static void setParentListHead(uint16_t flags, uint16_t parentAddress)
+{
+    if (nodeTypeFromFlags(flags) == NODE_TYPE_PARENT)
     {
-        currentNodeMgmtHandle.lastParentNode = getStartingParentAddress();
-        return;
+        setStartingParent(parentAddress);
     }
-
-    // If we have at least one node, loop through our credentials
-    while(next_node_addr != NODE_ADDR_NULL)
+    else
     {
-        // Get the node page number
-        temp_page_number = pageNumberFromAddress(next_node_addr);
+        setDataStartingParent(parentAddress);
+    }
+}
 
-        // Check that we're not out of memory bounds
-        if(temp_page_number >= FLASH_PAGE_COUNT)
+/**
+ * Writes an existing node whose comparison field changed, moving it to its sorted position while keeping its address
+ * @param   g                       The new node contents, its prev/next addresses are the ones stored in memory
+ * @param   nodeAddress             Address of the node
+ * @param   firstNodeAddress        Address of the first node of its kind
+ * @param   comparisonFieldOffset   The offset used to do the comparison used for the sorting
+ * @param   comparisonFieldLength   The length of the field used for comparison
+ * @param   parentAddress           For child nodes, parent node whose first child address is updated. NODE_ADDR_NULL for parent nodes, whose starting parent is updated
+ * @return  success status, RETURN_NOK if another node has the same comparison field
+ * @note    Handles necessary doubly linked list management, unlinking, linking and the list head update are journaled together
+ */
+RET_TYPE relinkGenericNode(gNode* g, uint16_t nodeAddress, uint16_t firstNodeAddress, uint8_t comparisonFieldOffset, uint8_t comparisonFieldLength, uint16_t parentAddress)
+{
+    gNode* memNodePtr = &(currentNodeMgmtHandle.tempgNode);
+    uint16_t oldPrevAddress = g->prevAddress;
+    uint16_t oldNextAddress = g->nextAddress;
+    uint16_t newPrevAddress = NODE_ADDR_NULL;
+    uint16_t newNextAddress = firstNodeAddress;
+    int8_t res;
+
+    // Find the new position in the list, skipping the node itself
+    while (newNextAddress != NODE_ADDR_NULL)
+    {
+        if (newNextAddress == nodeAddress)
         {
-            // TODO: Set a bool somewhere to mention corrupted memory
-            return;
+            newNextAddress = oldNextAddress;
+            continue;
         }
 
-        // Read first 9 bytes of the parent node as we just want to know the first letter
-        readDataFromFlash(temp_page_number, NODE_SIZE * nodeNumberFromAddress(next_node_addr), sizeof(temp_node_buffer), temp_node_buffer);
-        first_service_letter = pnode_ptr->service[0];
-
-        // LUT is only for chars between 'a' and 'z'
-        if ((first_service_letter >= 'a') && (first_service_letter <= 'z'))
+        readNode(memNodePtr, newNextAddress);
+        res = strncmp((char*)g+comparisonFieldOffset, (char*)memNodePtr+comparisonFieldOffset, comparisonFieldLength);
+        if (res == 0)
         {
-            // If LUT entry not populated, populate it
-            if (currentNodeMgmtHandle.servicesLut[first_service_letter - 'a'] == NODE_ADDR_NULL)
-            {
-                currentNodeMgmtHandle.servicesLut[first_service_letter - 'a'] = next_node_addr;
-            }
+            // Same comparison field as another node
+            return RETURN_NOK;
         }
+        else if (res < 0)
+        {
+            break;
+        }
+        newPrevAddress = newNextAddress;
+        newNextAddress = memNodePtr->nextAddress;
+    }
 
-        // Store last node address
-        currentNodeMgmtHandle.lastParentNode = next_node_addr;
-
-        // Fetch next node
-        next_node_addr = pnode_ptr->nextParentAddress;
+    // Still sorted: just rewrite the node
+    if ((newPrevAddress == oldPrevAddress) && (newNextAddress == oldNextAddress))
+    {
+        writeNodeDataBlockToFlash(nodeAddress, g);
+        return RETURN_OK;
     }
-}
 
-/*! \fn     getPreviousNextFirstCharAddressForNode(uint16_t nodeAddress, char c, bool next)
-*   \brief  Get the previous or next letter around a given addr + letter
-*   \param  nodeAddress     The address of the node to start searching from
-*   \param  c               The first letter of the input node
-*   \param  next            Boolean to search forward (true) or backwards (false)
-*   \ret    Struture of the found node address and its first character
-*   \note   The end and start will be marked with a '-' character and the address NODE_ADDR_NULL.
-*/
-nodeFirstCharAddr_t getPreviousNextFirstCharAddressForNode(uint16_t nodeAddress, char c, bool next)
-{
-    char firstChar = 0x00;
+    // Unlink the node from its neighbours and splice it at its new position, up to 5 nodes and the parent or user profile are journaled
+    startNodeWriteBatch(TRUE);
+    if (oldPrevAddress != NODE_ADDR_NULL)
+    {
+        readNode(memNodePtr, oldPrevAddress);
+        memNodePtr->nextAddress = oldNextAddress;
+        writeNodeDataBlockToFlash(oldPrevAddress, memNodePtr);
+    }
+    else if (parentAddress != NODE_ADDR_NULL)
+    {
+        setChildListHead(parentAddress, oldNextAddress);
+    }
+    else
+    {
+        setParentListHead(g->flags, oldNextAddress);
+    }
+    if (oldNextAddress != NODE_ADDR_NULL)
+    {
+        readNode(memNodePtr, oldNextAddress);
+        memNodePtr->prevAddress = oldPrevAddress;
+        writeNodeDataBlockToFlash(oldNextAddress, memNodePtr);
+    }
+    if (newPrevAddress != NODE_ADDR_NULL)
+    {
+        readNode(memNodePtr, newPrevAddress);
+        memNodePtr->nextAddress = nodeAddress;
+        writeNodeDataBlockToFlash(newPrevAddress, memNodePtr);
+    }
+    else if (parentAddress != NODE_ADDR_NULL)
+    {
+        setChildListHead(parentAddress, nodeAddress);
+    }
+    else
+    {
+        setParentListHead(g->flags, nodeAddress);
+    }
+    if (newNextAddress != NODE_ADDR_NULL)
+    {
+        readNode(memNodePtr, newNextAddress);
+        memNodePtr->prevAddress = nodeAddress;
+        writeNodeDataBlockToFlash(newNextAddress, memNodePtr);
+    }
+    g->prevAddress = newPrevAddress;
+    g->nextAddress = newNextAddress;
+    writeNodeDataBlockToFlash(nodeAddress, g);
+    commitNodeWriteBatch();
+
+    return RETURN_OK;
+}
+
+/**
+ * Updates a parent node in memory, moving it to its sorted position if its service changed
+ * @param   p                   Contents of node to update
+ * @param   parentNodeAddress   The address of the parent node to update
+ * @return  success status
+ * @note    Handles necessary doubly linked list management
+ */
+RET_TYPE updateParentNode(pNode *p, uint16_t parentNodeAddress)
+{
+    pNode* ip = (pNode*)&(currentNodeMgmtHandle.tempgNode);
+    uint16_t first_parent_addr;
+    RET_TYPE temprettype;
+
+    // Do not allow the user to change linked list links, or change child link
+    readParentNode(ip, parentNodeAddress);
+    if (memcmp((void*)p, (void*)ip, PNODE_LIB_FIELDS_LENGTH) != 0)
+    {
+        return RETURN_NOK;
+    }
+
+    // Set the first parent address depending on the type
+    if (nodeTypeFromFlags(p->flags) == NODE_TYPE_PARENT)
+    {
+        first_parent_addr = currentNodeMgmtHandle.firstParentNode;
+    }
+    else
+    {
+        first_parent_addr = currentNodeMgmtHandle.firstDataParentNode;
+    }
+
+    // The starting parent is updated in the same journaled batch as the node links
+    temprettype = relinkGenericNode((gNode*)p, parentNodeAddress, first_parent_addr, PNODE_COMPARISON_FIELD_OFFSET, NODE_PARENT_SIZE_OF_SERVICE, NODE_ADDR_NULL);
+
+    // Populate services LUT
+    populateServicesLut();
+
+    return temprettype;
+}
+
+/*! \fn     populateServicesLut(void)
+*   \brief  Reset our LUT for our services, which is then populated incrementally
+*   \note   Lookups populate it up to the letter they need, populateServicesLutSlice() completes it in the background
+*/
+void populateServicesLut(void)
+{
+    // Empty our current services list
+    memset(currentNodeMgmtHandle.servicesLut, 0x00, sizeof(currentNodeMgmtHandle.servicesLut));
+    currentNodeMgmtHandle.lastParentNode = currentNodeMgmtHandle.firstParentNode;
+    currentNodeMgmtHandle.lutLastLetter = 0;
+
+    // If the dedicated boolean in eeprom is sent, do not actually populate the LUT
+    if (getMooltipassParameterInEeprom(LUT_BOOT_POPULATING_PARAM) == FALSE)
+    {
+        currentNodeMgmtHandle.lastParentNode = getStartingParentAddress();
+        currentNodeMgmtHandle.lutNextParentNode = NODE_ADDR_NULL;
+        return;
+    }
+
+    // Start scanning from our first parent node
+    currentNodeMgmtHandle.lutNextParentNode = currentNodeMgmtHandle.firstParentNode;
+}
+
+/*! \fn     scanParentNodesForServicesLut(uint8_t letter, uint8_t nbNodes)
+*   \brief  Continue populating our LUT for our services, from where the last scan stopped
+*   \param  letter      Stop once a service starting after this letter is scanned
+*   \param  nbNodes     Max number of parent nodes to scan, 0 for no limit
+*/
+static void scanParentNodesForServicesLut(uint8_t letter, uint8_t nbNodes)
+{
+    uint16_t next_node_addr = currentNodeMgmtHandle.lutNextParentNode;
+    uint8_t temp_node_buffer[9];
+    uint16_t temp_page_number;
+    pNode* pnode_ptr = (pNode*)temp_node_buffer;
+    uint8_t first_service_letter;
+
+    // Parent nodes are sorted, so letters up to the last scanned one are populated
+    while ((next_node_addr != NODE_ADDR_NULL) && (currentNodeMgmtHandle.lutLastLetter <= letter))
+    {
+        // Get the node page number
+        temp_page_number = pageNumberFromAddress(next_node_addr);
+
+        // Check that we're not out of memory bounds
+        if(temp_page_number >= nodeAreaPageEnd)
+        {
+            // TODO: Set a bool somewhere to mention corrupted memory
+            next_node_addr = NODE_ADDR_NULL;
+            break;
+        }
+
+        // Read first 9 bytes of the parent node as we just want to know the first letter
+        readNodeBytesFromFlash(temp_page_number, NODE_SIZE * nodeNumberFromAddress(next_node_addr), sizeof(temp_node_buffer), temp_node_buffer);
+        first_service_letter = pnode_ptr->service[0];
+
+        // LUT is only for chars between 'a' and 'z'
+        if ((first_service_letter >= 'a') && (first_service_letter <= 'z'))
+        {
+            // If LUT entry not populated, populate it
+            if (currentNodeMgmtHandle.servicesLut[first_service_letter - 'a'] == NODE_ADDR_NULL)
+            {
+                currentNodeMgmtHandle.servicesLut[first_service_letter - 'a'] = next_node_addr;
+            }
+        }
+
+        // Store last node address & letter
+        currentNodeMgmtHandle.lastParentNode = next_node_addr;
+        currentNodeMgmtHandle.lutLastLetter = first_service_letter;
+
+        // Fetch next node
+        next_node_addr = pnode_ptr->nextParentAddress;
+
+        // Stop at the end of the slice
+        if ((nbNodes != 0) && (--nbNodes == 0))
+        {
+            break;
+        }
+    }
+
+    currentNodeMgmtHandle.lutNextParentNode = next_node_addr;
+}
+
+/*! \fn     populateServicesLutSlice(void)
+*   \brief  Populate a slice of our LUT for our services, called from the main loop
+*/
+void populateServicesLutSlice(void)
+{
+    scanParentNodesForServicesLut(0xFF, LUT_POPULATING_SLICE_NODES);
+}
+
+/**
+ * Gets the users last parent node, completing the LUT population if needed
+ * @return  The address
+ */
+uint16_t getLastParentAddress(void)
+{
+    // The last parent node is only known once the LUT is populated
+    scanParentNodesForServicesLut(0xFF, 0);
+    return currentNodeMgmtHandle.lastParentNode;
+}
+
+/*! \fn     getPreviousNextFirstCharAddressForNode(uint16_t nodeAddress, char c, bool next)
+*   \brief  Get the previous or next letter around a given addr + letter
+*   \param  nodeAddress     The address of the node to start searching from
+*   \param  c               The first letter of the input node
+*   \param  next            Boolean to search forward (true) or backwards (false)
+*   \ret    Struture of the found node address and its first character
+*   \note   The end and start will be marked with a '-' character and the address NODE_ADDR_NULL.
+*/
+nodeFirstCharAddr_t getPreviousNextFirstCharAddressForNode(uint16_t nodeAddress, char c, bool next)
+{
+    char firstChar = 0x00;
     uint16_t addr = NODE_ADDR_NULL;
 
     // Find next/previous node address with a different starting character
@@ -1028,6 +1639,12 @@ uint16_t getParentNodeForLetter(uint8_t letter)
     // LUT is only for chars between 'a' and 'z'
     if ((letter >= 'a') && (letter <= 'z'))
     {
+        // Populate the LUT up to the given letter if the background population didn't get there yet
+        if (currentNodeMgmtHandle.servicesLut[letter - 'a'] == NODE_ADDR_NULL)
+        {
+            scanParentNodesForServicesLut(letter, 0);
+        }
+
         // If the entry is populated, return it
         if (currentNodeMgmtHandle.servicesLut[letter - 'a'] != NODE_ADDR_NULL)
         {
@@ -1076,13 +1693,13 @@ uint8_t findFreeNodes(uint8_t nbNodes, uint16_t* nodeArray, uint16_t startPage,
     }
 
     // for each page
-    for(pageItr = startPage; pageItr < FLASH_PAGE_COUNT; pageItr++)
+    for(pageItr = startPage; pageItr < NODE_JOURNAL_FIRST_PAGE; pageItr++)
     {
         // for each possible parent node in the page (changes per flash chip)
         for(nodeItr = startNode; nodeItr < (FLASH_BYTES_PER_PAGE / NODE_SIZE); nodeItr++)
         {
             // read node flags (2 bytes - fixed size)
-            readDataFromFlash(pageItr, NODE_SIZE*nodeItr, 2, &nodeFlags);
+            readNodeBytesFromFlash(pageItr, NODE_SIZE*nodeItr, 2, &nodeFlags);
 
             // If this slot is OK
             if(validBitFromFlags(nodeFlags) == NODE_VBIT_INVALID)
@@ -1103,18 +1720,594 @@ uint8_t findFreeNodes(uint8_t nbNodes, uint16_t* nodeArray, uint16_t startPage,
     return nbNodesFound;
 }
 
+/*! \fn     findFreeNodesFromAddress(uint8_t nbNodes, uint16_t* nodeArray, uint16_t startAddress)
+*   \brief  Find free nodes from a given address, wrapping around at the end of the memory
+*   \param  nbNodes         Number of nodes we want to find
+*   \param  nodeArray       An array where to store the addresses
+*   \param  startAddress    Node address where to start the scanning
+*   \return the number of nodes found
+*   \note   Allocating from a rotating address instead of the lowest free slot spreads the writes over the memory
+*/
+uint8_t findFreeNodesFromAddress(uint8_t nbNodes, uint16_t* nodeArray, uint16_t startAddress)
+{
+    uint8_t nbNodesFound = findFreeNodes(nbNodes, nodeArray, pageNumberFromAddress(startAddress), nodeNumberFromAddress(startAddress));
+
+    if (nbNodesFound < nbNodes)
+    {
+        uint8_t nbWrappedNodes = findFreeNodes(nbNodes - nbNodesFound, &nodeArray[nbNodesFound], 0, 0);
+
+        // Nodes found after the start address are already in the array
+        while ((nbWrappedNodes > 0) && (nodeArray[nbNodesFound + nbWrappedNodes - 1] >= startAddress))
+        {
+            nbWrappedNodes--;
+        }
+        nbNodesFound += nbWrappedNodes;
+    }
+
+    return nbNodesFound;
+}
+
+/*! \fn     findFreeNodeRun(uint16_t nbNodes, uint16_t startAddress)
+*   \brief  Find a run of contiguous free node slots, starting on a page boundary
+*   \param  nbNodes         Number of contiguous free slots wanted
+*   \param  startAddress    Node address where to start the scanning
+*   \return Address of the first slot of the run, NODE_ADDR_NULL if none was found
+*   \note   Nodes laid out in a run in list order are walked through consecutive pages
+*/
+uint16_t findFreeNodeRun(uint16_t nbNodes, uint16_t startAddress)
+{
+    uint16_t pageItr = pageNumberFromAddress(startAddress);
+    uint16_t runStartPage = 0;
+    uint16_t runLength = 0;
+    uint16_t nodeFlags;
+    uint8_t nodeItr;
+
+    // Runs start on a page boundary
+    if (nodeNumberFromAddress(startAddress) != 0)
+    {
+        pageItr++;
+    }
+    if (pageItr < GRAPHIC_ZONE_PAGE_END)
+    {
+        pageItr = GRAPHIC_ZONE_PAGE_END;
+    }
+    if (nbNodes == 0)
+    {
+        return NODE_ADDR_NULL;
+    }
+
+    for (; pageItr < NODE_JOURNAL_FIRST_PAGE; pageItr++)
+    {
+        for (nodeItr = 0; nodeItr < (FLASH_BYTES_PER_PAGE / NODE_SIZE); nodeItr++)
+        {
+            readNodeBytesFromFlash(pageItr, NODE_SIZE*nodeItr, 2, &nodeFlags);
+            if (validBitFromFlags(nodeFlags) != NODE_VBIT_INVALID)
+            {
+                runLength = 0;
+            }
+            else if ((runLength != 0) || (nodeItr == 0))
+            {
+                if (runLength++ == 0)
+                {
+                    runStartPage = pageItr;
+                }
+                if (runLength == nbNodes)
+                {
+                    return constructAddress(runStartPage, 0);
+                }
+            }
+        }
+    }
+
+    return NODE_ADDR_NULL;
+}
+
 /*! \fn     scanNodeUsage(void)
 *   \brief  Scan memory to find empty slots
 */
 void scanNodeUsage(void)
 {
     // Find one free node. If we don't find it, set the next to the null addr, we start looking from the just taken node
-    if (findFreeNodes(1, &currentNodeMgmtHandle.nextFreeNode, pageNumberFromAddress(currentNodeMgmtHandle.nextFreeNode), nodeNumberFromAddress(currentNodeMgmtHandle.nextFreeNode)) == 0)
+    if (findFreeNodesFromAddress(1, &currentNodeMgmtHandle.nextFreeNode, currentNodeMgmtHandle.nextFreeNode) == 0)
     {
         currentNodeMgmtHandle.nextFreeNode = NODE_ADDR_NULL;
     }
 }
 
+/*! \fn     getNodeRangeDigest(uint16_t* address, uint16_t* nbSlots)
+*   \brief  Compute a digest over the current user nodes stored in a range of node slots
+*   \param  address Pointer to the first slot address, set to the address following the range (NODE_ADDR_NULL at the end of the memory)
+*   \param  nbSlots Pointer to the number of slots to scan, set to the number of slots actually scanned
+*   \return CRC-32 over the address (LSB first) followed by the contents of each valid node belonging to the current user
+*   \note   Free slots and other users nodes are left out, so that the host can compute the same digest from its own copy and bisect to the changed ranges
+*/
+uint32_t getNodeRangeDigest(uint16_t* address, uint16_t* nbSlots)
+{
+    uint16_t pageItr = pageNumberFromAddress(*address);
+    uint8_t nodeItr = nodeNumberFromAddress(*address);
+    uint16_t nbSlotsScanned = 0;
+    uint16_t nodeAddress;
+    uint32_t crc = 0;
+    gNode node;
+
+    // Start at the first node slot if the address is in the graphics zone or not a slot address
+    if (pageItr < GRAPHIC_ZONE_PAGE_END)
+    {
+        pageItr = GRAPHIC_ZONE_PAGE_END;
+        nodeItr = 0;
+    }
+    if (nodeItr >= (FLASH_BYTES_PER_PAGE / NODE_SIZE))
+    {
+        pageItr++;
+        nodeItr = 0;
+    }
+
+    while ((nbSlotsScanned < *nbSlots) && (pageItr < nodeAreaPageEnd))
+    {
+        // Only read the full node if its flags say it belongs to us
+        readNodeBytesFromFlash(pageItr, NODE_SIZE*nodeItr, 2, &node.flags);
+        if ((validBitFromFlags(node.flags) != NODE_VBIT_INVALID) && (userIdFromFlags(node.flags) == getCurrentUserID()))
+        {
+            nodeAddress = constructAddress(pageItr, nodeItr);
+            readNodeBytesFromFlash(pageItr, NODE_SIZE*nodeItr, NODE_SIZE, &node);
+            crc = crc32_update(crc, (uint8_t*)&nodeAddress, sizeof(nodeAddress));
+            crc = crc32_update(crc, (uint8_t*)&node, NODE_SIZE);
+        }
+        nbSlotsScanned++;
+
+        // Move to the next slot
+        if (++nodeItr == (FLASH_BYTES_PER_PAGE / NODE_SIZE))
+        {
+            pageItr++;
+            nodeItr = 0;
+        }
+    }
+
+    if (pageItr < nodeAreaPageEnd)
+    {
+        *address = constructAddress(pageItr, nodeItr);
+    }
+    else
+    {
+        *address = NODE_ADDR_NULL;
+    }
+    *nbSlots = nbSlotsScanned;
+    return crc;
+}
+
+/*! \fn     dbCheckNodeAddress(uint16_t nodeAddress, uint8_t nodeType)
+*   \brief  Check that an address points to a valid node of the current user with a given type
+*   \param  nodeAddress Node address
+*   \param  nodeType    Expected node type
+*   \return OK / NOK
+*/
+static RET_TYPE dbCheckNodeAddress(uint16_t nodeAddress, uint8_t nodeType)
+{
+    uint16_t pageNumber = pageNumberFromAddress(nodeAddress);
+    uint16_t flags;
+
+    // Check that the address is a node slot
+    if ((pageNumber < GRAPHIC_ZONE_PAGE_END) || (pageNumber >= nodeAreaPageEnd) || (nodeNumberFromAddress(nodeAddress) >= (FLASH_BYTES_PER_PAGE / NODE_SIZE)))
+    {
+        return RETURN_NOK;
+    }
+
+    readNodeBytesFromFlash(pageNumber, NODE_SIZE * nodeNumberFromAddress(nodeAddress), 2, &flags);
+    if ((validBitFromFlags(flags) == NODE_VBIT_VALID) && (userIdFromFlags(flags) == currentNodeMgmtHandle.currentUserId) && (nodeTypeFromFlags(flags) == nodeType))
+    {
+        return RETURN_OK;
+    }
+    else
+    {
+        return RETURN_NOK;
+    }
+}
+
+/*! \fn     dbCheckNextFieldOffset(uint8_t nodeType)
+*   \brief  Get the offset of the next node address inside a node
+*   \param  nodeType    Node type
+*   \return The offset
+*/
+static inline uint8_t dbCheckNextFieldOffset(uint8_t nodeType)
+{
+    return (nodeType == NODE_TYPE_DATA) ? offsetof(dNode, nextDataAddress) : offsetof(gNode, nextAddress);
+}
+
+/*! \fn     dbCheckNextAddress(uint16_t nodeAddress, uint8_t nodeType)
+*   \brief  Get the next node address stored in a node
+*   \param  nodeAddress Node address
+*   \param  nodeType    Node type
+*   \return The next node address, NODE_ADDR_NULL if it doesn't point to a valid node of the same list
+*/
+static uint16_t dbCheckNextAddress(uint16_t nodeAddress, uint8_t nodeType)
+{
+    uint16_t nextAddress;
+
+    readNodeBytesFromFlash(pageNumberFromAddress(nodeAddress), NODE_SIZE * nodeNumberFromAddress(nodeAddress) + dbCheckNextFieldOffset(nodeType), 2, &nextAddress);
+    if (dbCheckNodeAddress(nextAddress, nodeType) == RETURN_OK)
+    {
+        return nextAddress;
+    }
+    else
+    {
+        return NODE_ADDR_NULL;
+    }
+}
+
+/*! \fn     dbCheckBreakListLoop(uint16_t firstNodeAddress, uint8_t nodeType, dbCheckStats* stats)
+*   \brief  Detect a loop in a node list and break it at its last node
+*   \param  firstNodeAddress    First node of the list, which must be valid
+*   \param  nodeType            Node type
+*   \param  stats               Check statistics
+*   \note   Brent's algorithm, only the next addresses are read so that the list walk can't go on forever
+*/
+static void dbCheckBreakListLoop(uint16_t firstNodeAddress, uint8_t nodeType, dbCheckStats* stats)
+{
+    gNode* node = &(currentNodeMgmtHandle.tempgNode);
+    uint16_t tortoise = firstNodeAddress;
+    uint16_t hare = dbCheckNextAddress(firstNodeAddress, nodeType);
+    uint16_t power = 1;
+    uint16_t length = 1;
+    uint16_t i;
+
+    while ((hare != NODE_ADDR_NULL) && (hare != tortoise))
+    {
+        if (power == length)
+        {
+            tortoise = hare;
+            power <<= 1;
+            length = 0;
+        }
+        hare = dbCheckNextAddress(hare, nodeType);
+        length++;
+    }
+
+    if (hare == NODE_ADDR_NULL)
+    {
+        return;
+    }
+
+    // Find the first node of the loop: the hare is length nodes ahead of the tortoise
+    tortoise = hare = firstNodeAddress;
+    for (i = 0; i < length; i++)
+    {
+        hare = dbCheckNextAddress(hare, nodeType);
+    }
+    while (tortoise != hare)
+    {
+        tortoise = dbCheckNextAddress(tortoise, nodeType);
+        hare = dbCheckNextAddress(hare, nodeType);
+    }
+
+    // Go to the last node of the loop and end the list there
+    for (i = 1; i < length; i++)
+    {
+        hare = dbCheckNextAddress(hare, nodeType);
+    }
+    readNodeDataBlockFromFlash(hare, node);
+    *(uint16_t*)((uint8_t*)node + dbCheckNextFieldOffset(nodeType)) = NODE_ADDR_NULL;
+    writeNodeDataBlockToFlash(hare, node);
+    stats->nbRepairedLinks++;
+}
+
+/*! \fn     dbCheckSortOrder(uint16_t prevAddress, gNode* node, uint8_t comparisonFieldOffset, uint8_t comparisonFieldLength)
+*   \brief  Check that a node is sorted after its previous node, using the createGenericNode comparison
+*   \param  prevAddress             Previous node address
+*   \param  node                    The node
+*   \param  comparisonFieldOffset   The offset of the field used for the sorting
+*   \param  comparisonFieldLength   The length of the field used for the sorting
+*   \return OK / NOK
+*/
+static RET_TYPE dbCheckSortOrder(uint16_t prevAddress, gNode* node, uint8_t comparisonFieldOffset, uint8_t comparisonFieldLength)
+{
+    uint8_t prevField[NODE_CHILD_SIZE_OF_LOGIN];
+
+    readNodeBytesFromFlash(pageNumberFromAddress(prevAddress), NODE_SIZE * nodeNumberFromAddress(prevAddress) + comparisonFieldOffset, comparisonFieldLength, prevField);
+    if (strncmp((char*)prevField, (char*)node + comparisonFieldOffset, comparisonFieldLength) < 0)
+    {
+        return RETURN_OK;
+    }
+    else
+    {
+        return RETURN_NOK;
+    }
+}
+
+/*! \fn     dbCheckIsListHead(uint16_t nodeAddress, uint8_t nodeType, uint16_t stopParentAddress)
+*   \brief  Check whether a node is the first node of one of the current user lists
+*   \param  nodeAddress         Node address
+*   \param  nodeType            Node type, parent, data parent or child
+*   \param  stopParentAddress   For child nodes, parent node where to stop looking, NODE_ADDR_NULL to look in all the parents
+*   \return OK / NOK
+*   \note   For child nodes the parent list is walked, its loop must have been broken
+*/
+static RET_TYPE dbCheckIsListHead(uint16_t nodeAddress, uint8_t nodeType, uint16_t stopParentAddress)
+{
+    uint16_t parentAddress = currentNodeMgmtHandle.firstParentNode;
+    uint16_t childAddress;
+
+    if (nodeType == NODE_TYPE_PARENT)
+    {
+        return (nodeAddress == currentNodeMgmtHandle.firstParentNode) ? RETURN_OK : RETURN_NOK;
+    }
+    else if (nodeType == NODE_TYPE_PARENT_DATA)
+    {
+        return (nodeAddress == currentNodeMgmtHandle.firstDataParentNode) ? RETURN_OK : RETURN_NOK;
+    }
+
+    // Look for a parent whose first child it is
+    if (dbCheckNodeAddress(parentAddress, NODE_TYPE_PARENT) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    while ((parentAddress != NODE_ADDR_NULL) && (parentAddress != stopParentAddress))
+    {
+        readNodeBytesFromFlash(pageNumberFromAddress(parentAddress), NODE_SIZE * nodeNumberFromAddress(parentAddress) + offsetof(pNode, nextChildAddress), 2, &childAddress);
+        if (childAddress == nodeAddress)
+        {
+            return RETURN_OK;
+        }
+        parentAddress = dbCheckNextAddress(parentAddress, NODE_TYPE_PARENT);
+    }
+    return RETURN_NOK;
+}
+
+/*! \fn     dbCheckIsCrossLinked(uint16_t nodeAddress, uint16_t backAddress, uint8_t nodeType)
+*   \brief  Check whether a node reached through a link is also reached through the link its back link stands for
+*   \param  nodeAddress Node address
+*   \param  backAddress Back link stored in the node, which differs from the node it was reached from
+*   \param  nodeType    Node type, parent, data parent or child
+*   \return OK if the node it links back to links to it, or if it is the first node of a list and links back to nothing
+*/
+static RET_TYPE dbCheckIsCrossLinked(uint16_t nodeAddress, uint16_t backAddress, uint8_t nodeType)
+{
+    if (backAddress == NODE_ADDR_NULL)
+    {
+        return dbCheckIsListHead(nodeAddress, nodeType, NODE_ADDR_NULL);
+    }
+    else if ((dbCheckNodeAddress(backAddress, nodeType) == RETURN_OK) && (dbCheckNextAddress(backAddress, nodeType) == nodeAddress))
+    {
+        return RETURN_OK;
+    }
+    else
+    {
+        return RETURN_NOK;
+    }
+}
+
+/*! \fn     dbCheckList(uint16_t firstNodeAddress, uint8_t nodeType, uint16_t parentAddress, dbCheckStats* stats)
+*   \brief  Check and repair a node list and the child lists of its nodes
+*   \param  firstNodeAddress    First node of the list
+*   \param  nodeType            Type of the nodes in the list
+*   \param  parentAddress       Parent node of a child or data node list, NODE_ADDR_NULL for a parent list
+*   \param  stats               Check statistics
+*   \return The first node address, NODE_ADDR_NULL if the given one was dangling
+*   \note   Links to nodes that aren't valid nodes of the current user with the right type are cut, back links are set to the walked ones
+*   \note   The walk stops at a node whose back link stands for another valid link to it, or at a first child already first child of a previous parent: that cross-link is reported, not repaired
+*/
+static uint16_t dbCheckList(uint16_t firstNodeAddress, uint8_t nodeType, uint16_t parentAddress, dbCheckStats* stats)
+{
+    gNode* node = &(currentNodeMgmtHandle.tempgNode);
+    uint16_t prevAddress = NODE_ADDR_NULL;
+    uint16_t nodeAddress = firstNodeAddress;
+    uint16_t* nextAddressPtr = (uint16_t*)((uint8_t*)node + dbCheckNextFieldOffset(nodeType));
+    uint16_t childAddress, newChildAddress;
+    uint8_t modified;
+
+    if (firstNodeAddress == NODE_ADDR_NULL)
+    {
+        return NODE_ADDR_NULL;
+    }
+
+    // Dangling first node
+    if (dbCheckNodeAddress(firstNodeAddress, nodeType) != RETURN_OK)
+    {
+        stats->nbRepairedLinks++;
+        return NODE_ADDR_NULL;
+    }
+
+    dbCheckBreakListLoop(firstNodeAddress, nodeType, stats);
+
+    while (nodeAddress != NODE_ADDR_NULL)
+    {
+        readNodeDataBlockFromFlash(nodeAddress, node);
+
+        // Node also reached from another list or list position, it is walked from there. Data nodes are only linked forward
+        if (((nodeType != NODE_TYPE_DATA) && (node->prevAddress != prevAddress) && (dbCheckIsCrossLinked(nodeAddress, node->prevAddress, nodeType) == RETURN_OK))
+            || ((nodeType == NODE_TYPE_CHILD) && (prevAddress == NODE_ADDR_NULL) && (dbCheckIsListHead(nodeAddress, nodeType, parentAddress) == RETURN_OK)))
+        {
+            stats->nbCrossLinks++;
+            break;
+        }
+        stats->nbNodes[nodeType]++;
+        modified = FALSE;
+
+        // Data nodes are only linked forward
+        if ((nodeType != NODE_TYPE_DATA) && (node->prevAddress != prevAddress))
+        {
+            node->prevAddress = prevAddress;
+            modified = TRUE;
+        }
+        if ((*nextAddressPtr != NODE_ADDR_NULL) && (dbCheckNodeAddress(*nextAddressPtr, nodeType) != RETURN_OK))
+        {
+            *nextAddressPtr = NODE_ADDR_NULL;
+            modified = TRUE;
+        }
+        if (modified != FALSE)
+        {
+            writeNodeDataBlockToFlash(nodeAddress, node);
+            stats->nbRepairedLinks++;
+        }
+
+        // Check the sort order, which isn't repaired
+        if (prevAddress != NODE_ADDR_NULL)
+        {
+            if (((nodeType == NODE_TYPE_PARENT) || (nodeType == NODE_TYPE_PARENT_DATA)) && (dbCheckSortOrder(prevAddress, node, PNODE_COMPARISON_FIELD_OFFSET, NODE_PARENT_SIZE_OF_SERVICE) != RETURN_OK))
+            {
+                stats->nbUnsortedNodes++;
+            }
+            else if ((nodeType == NODE_TYPE_CHILD) && (dbCheckSortOrder(prevAddress, node, CNODE_COMPARISON_FIELD_OFFSET, NODE_CHILD_SIZE_OF_LOGIN) != RETURN_OK))
+            {
+                stats->nbUnsortedNodes++;
+            }
+        }
+        prevAddress = nodeAddress;
+        nodeAddress = *nextAddressPtr;
+
+        // Check the children of parent nodes, the node buffer is reused
+        if ((nodeType == NODE_TYPE_PARENT) || (nodeType == NODE_TYPE_PARENT_DATA))
+        {
+            childAddress = ((pNode*)node)->nextChildAddress;
+            newChildAddress = dbCheckList(childAddress, (nodeType == NODE_TYPE_PARENT) ? NODE_TYPE_CHILD : NODE_TYPE_DATA, prevAddress, stats);
+            if (newChildAddress != childAddress)
+            {
+                readNodeDataBlockFromFlash(prevAddress, node);
+                ((pNode*)node)->nextChildAddress = newChildAddress;
+                writeNodeDataBlockToFlash(prevAddress, node);
+            }
+        }
+    }
+
+    return firstNodeAddress;
+}
+
+/*! \fn     checkUserDatabase(dbCheckStats* stats)
+*   \brief  Check the current user database, repairing its dangling links
+*   \param  stats   Where to store the check statistics
+*   \note   Parent, child and data lists are walked once without going through readNode(), as it stops on invalid nodes
+*/
+void checkUserDatabase(dbCheckStats* stats)
+{
+    uint16_t nbUserNodes = 0;
+    uint16_t nbReachedNodes;
+    uint16_t parentAddress, childAddress;
+    uint16_t pageItr;
+    uint8_t nodeItr;
+    uint16_t flags;
+
+    memset((void*)stats, 0, sizeof(*stats));
+
+    // Walk the credential and data lists
+    parentAddress = dbCheckList(currentNodeMgmtHandle.firstParentNode, NODE_TYPE_PARENT, NODE_ADDR_NULL, stats);
+    if (parentAddress != currentNodeMgmtHandle.firstParentNode)
+    {
+        setStartingParent(parentAddress);
+    }
+    parentAddress = dbCheckList(currentNodeMgmtHandle.firstDataParentNode, NODE_TYPE_PARENT_DATA, NODE_ADDR_NULL, stats);
+    if (parentAddress != currentNodeMgmtHandle.firstDataParentNode)
+    {
+        setDataStartingParent(parentAddress);
+    }
+
+    // Remove the favorites pointing to invalid nodes
+    for (uint8_t i = 0; i < USER_MAX_FAV; i++)
+    {
+        readFav(i, &parentAddress, &childAddress);
+        if ((parentAddress != NODE_ADDR_NULL) && ((dbCheckNodeAddress(parentAddress, NODE_TYPE_PARENT) != RETURN_OK) || (dbCheckNodeAddress(childAddress, NODE_TYPE_CHILD) != RETURN_OK)))
+        {
+            setFav(i, NODE_ADDR_NULL, NODE_ADDR_NULL);
+            stats->nbRepairedLinks++;
+        }
+    }
+
+    // Count the user nodes that weren't reached
+    for (pageItr = GRAPHIC_ZONE_PAGE_END; pageItr < nodeAreaPageEnd; pageItr++)
+    {
+        for (nodeItr = 0; nodeItr < (FLASH_BYTES_PER_PAGE / NODE_SIZE); nodeItr++)
+        {
+            readNodeBytesFromFlash(pageItr, NODE_SIZE*nodeItr, 2, &flags);
+            if ((validBitFromFlags(flags) == NODE_VBIT_VALID) && (userIdFromFlags(flags) == currentNodeMgmtHandle.currentUserId))
+            {
+                nbUserNodes++;
+            }
+        }
+    }
+    nbReachedNodes = stats->nbNodes[NODE_TYPE_PARENT] + stats->nbNodes[NODE_TYPE_CHILD] + stats->nbNodes[NODE_TYPE_PARENT_DATA] + stats->nbNodes[NODE_TYPE_DATA];
+    // A data node reached from two lists is counted twice
+    stats->nbOrphanNodes = (nbUserNodes > nbReachedNodes) ? (nbUserNodes - nbReachedNodes) : 0;
+
+    if (stats->nbRepairedLinks != 0)
+    {
+        userDBChangedActions();
+        populateServicesLut();
+    }
+}
+
+/*! \fn     mergeParentNode(pNode* p, uint16_t* cursor)
+*   \brief  Find the credential parent node of a service or create it, starting from a cursor in the parent list
+*   \param  p       Parent node containing the service, overwritten when the node is created
+*   \param  cursor  Address of a parent node before the service (NODE_ADDR_NULL for the first parent), set to the service parent node
+*   \return success status
+*   \note   Services given in sorted order are merged in a single pass over the parent list
+*   \note   The services LUT isn't updated, as it is populated when leaving memory management mode
+*/
+RET_TYPE mergeParentNode(pNode* p, uint16_t* cursor)
+{
+    pNode* memNodePtr = (pNode*)&(currentNodeMgmtHandle.tempgNode);
+    uint16_t previousAddress = NODE_ADDR_NULL;
+    uint16_t addr = *cursor;
+    uint16_t newAddress, temp_address;
+    RET_TYPE temprettype;
+    int8_t res;
+
+    // Start from the first parent if the cursor isn't a parent anymore or if it comes after the service
+    if ((addr == NODE_ADDR_NULL) || (dbCheckNodeAddress(addr, NODE_TYPE_PARENT) != RETURN_OK))
+    {
+        addr = currentNodeMgmtHandle.firstParentNode;
+    }
+    else
+    {
+        readParentNode(memNodePtr, addr);
+        if (strncmp((char*)p->service, (char*)memNodePtr->service, NODE_PARENT_SIZE_OF_SERVICE) < 0)
+        {
+            addr = currentNodeMgmtHandle.firstParentNode;
+        }
+    }
+
+    // Look for the service from there
+    while (addr != NODE_ADDR_NULL)
+    {
+        readParentNode(memNodePtr, addr);
+        res = strncmp((char*)p->service, (char*)memNodePtr->service, NODE_PARENT_SIZE_OF_SERVICE);
+        if (res == 0)
+        {
+            *cursor = addr;
+            return RETURN_OK;
+        }
+        else if (res < 0)
+        {
+            break;
+        }
+        previousAddress = addr;
+        addr = memNodePtr->nextParentAddress;
+    }
+
+    // Not found: insert it right after the last smaller service
+    p->nextChildAddress = NODE_ADDR_NULL;
+    nodeTypeToFlags(&(p->flags), NODE_TYPE_PARENT);
+    newAddress = currentNodeMgmtHandle.nextFreeNode;
+    if (previousAddress == NODE_ADDR_NULL)
+    {
+        startNodeWriteBatch(TRUE);
+        temprettype = createGenericNode((gNode*)p, currentNodeMgmtHandle.firstParentNode, &temp_address, PNODE_COMPARISON_FIELD_OFFSET, NODE_PARENT_SIZE_OF_SERVICE);
+        if ((temprettype == RETURN_OK) && (temp_address != currentNodeMgmtHandle.firstParentNode))
+        {
+            setStartingParent(temp_address);
+        }
+        commitNodeWriteBatch();
+    }
+    else
+    {
+        temprettype = createGenericNode((gNode*)p, previousAddress, &temp_address, PNODE_COMPARISON_FIELD_OFFSET, NODE_PARENT_SIZE_OF_SERVICE);
+    }
+
+    if (temprettype == RETURN_OK)
+    {
+        *cursor = newAddress;
+    }
+    return temprettype;
+}
+
 /*! \fn     deleteCurrentUserFromFlash(void)
 *   \brief  Delete user data from flash
 */
@@ -1126,10 +2319,14 @@ void deleteCurrentUserFromFlash(void)
     pNode temp_pnode;
     cNode temp_cnode;
 
+    // Forget the pending last used dates
+    usedChildNodesQueueCount = 0;
+
     // Delete user profile memory
     formatUserProfileMemory(currentNodeMgmtHandle.currentUserId);
 
-    // Then browse through all the credentials to delete them
+    // Then browse through all the credentials to delete them, sibling nodes often share pages
+    startNodeWriteBatch(FALSE);
     for (uint8_t i = 0; i < 2; i++)
     {
         while (next_parent_addr != NODE_ADDR_NULL)
@@ -1180,6 +2377,10 @@ void deleteCurrentUserFromFlash(void)
         // First loop done, remove data nodes
         next_parent_addr = currentNodeMgmtHandle.firstDataParentNode;
     }
+    commitNodeWriteBatch();
+
+    // The user profile was formatted, don't save the allocation cursor into it at card removal
+    currentNodeMgmtHandle.nextFreeNode = NODE_ADDR_NULL;
 
     // Empty service lut (not needed as the user is deleted)
     //memset(currentNodeMgmtHandle.servicesLut, 0x00, sizeof(currentNodeMgmtHandle.servicesLut));
@@ -1187,7 +2388,7 @@ void deleteCurrentUserFromFlash(void)
 
 /**
  * Updates a child or child start of data node in memory. Handles alphabetical reorder of nodes.
- *   Scans for nextFreeChildNode after completion.  Modifies the node management handle
+ *   A login change moves the node to its new position, keeping its address
  * @param   p               Parent Node of the Child Node
  * @param   c               Contents of node to update
  * @param   pAddr           The address to the parent node of the child
@@ -1232,19 +2433,15 @@ RET_TYPE updateChildNode(pNode *p, cNode *c, uint16_t pAddr, uint16_t cAddr)
         }
         else
         {
-            // delete node in memory
-            ret = deleteChildNode(pAddr, cAddr, ic);
+            // move the node to its new position, keeping its address
+            ret = relinkGenericNode((gNode*)c, cAddr, ip->nextChildAddress, CNODE_COMPARISON_FIELD_OFFSET, NODE_CHILD_SIZE_OF_LOGIN, pAddr);
             if(ret != RETURN_OK)
             {
                 return ret;
             }
 
-            // create node in memory
-            ret = createChildNode(pAddr, *(&c));
-            if(ret != RETURN_OK)
-            {
-                return ret;
-            }
+            // write is destructive.. read
+            readChildNode(&(*c), cAddr);
         }
         return ret;
 }
@@ -1272,7 +2469,11 @@ RET_TYPE deleteChildNode(uint16_t pAddr, uint16_t cAddr, cNode *ic)
     prevAddress = ic->prevChildAddress;
     nextAddress = ic->nextChildAddress;
 
-    // Set child contents to FF
+    // the slot may be reused by another node
+    removeChildNodeFromUsedQueue(cAddr);
+
+    // Set child contents to FF, the neighbour updates often hit the same pages, the mutation is journaled
+    startNodeWriteBatch(TRUE);
     memset(ic, 0xFF, NODE_SIZE);
     writeNodeDataBlockToFlash(cAddr, ic);
 
@@ -1314,6 +2515,7 @@ RET_TYPE deleteChildNode(uint16_t pAddr, uint16_t cAddr, cNode *ic)
         writeNodeDataBlockToFlash(pAddr, ip);
     }
 
+    commitNodeWriteBatch();
     scanNodeUsage();
     return RETURN_OK;
 }
@@ -99,11 +99,12 @@ typedef enum _nodeType
 #define USER_START_NODE_SIZE 2
 #define USER_FAV_SIZE 4
 #define USER_MAX_FAV 14
-#define USER_DATA_START_NODE_SIZE_RES 4
+#define USER_DATA_START_NODE_SIZE_RES 4 // 2 bytes for the data starting parent, 2 bytes for the node allocation cursor
 #define USER_RES_CTR 4
 #define USER_PROFILE_SIZE (USER_START_NODE_SIZE+(USER_MAX_FAV*USER_FAV_SIZE)+USER_DATA_START_NODE_SIZE_RES+USER_RES_CTR)
 #define USER_CTR_SIZE 3             // USER_RES_CTR is set to 4 but the actual CTR is 3 bytes long and the last byte is for the user DB change number
 #define USER_DB_CHANGE_NB_SIZE  1
+#define USER_PROFILES_PAGE_END  ((NODE_MAX_UID * USER_PROFILE_SIZE + FLASH_BYTES_PER_PAGE - 1) / FLASH_BYTES_PER_PAGE)   // First page after the user profiles
 
 #define GRAPHIC_ZONE_START          (8*FLASH_BYTES_PER_PAGE)
 #define GRAPHIC_ZONE_PAGE_START     (8)
@@ -112,6 +113,16 @@ typedef enum _nodeType
 
 #define DELETE_POLICY_WRITE_ONES 0xFF  /*! Node Deletion Policy Ones Memset Value */
 
+#define NODE_USED_QUEUE_SIZE 4          /*! Number of used child nodes whose last used date update can be deferred */
+#define NODE_WRITE_BATCH_NO_PAGE 0xFFFF /*! No page staged by the node write batch */
+#define LUT_POPULATING_SLICE_NODES  16  /*! Number of parent nodes scanned by each background LUT populating slice */
+
+#define NODE_JOURNAL_MAX_PAGES          6       /*! Max number of pages modified by a journaled node mutation: old & new neighbours, node, parent node or user profile */
+#define NODE_JOURNAL_FIRST_PAGE         (FLASH_PAGE_COUNT - FLASH_PAGES_PER_SECTOR)             /*! The node journal has the last flash sector for itself, its pages are rewritten far more often than the other ones */
+#define NODE_JOURNAL_SLOT_PAGES         (1 + NODE_JOURNAL_MAX_PAGES)                            /*! A journal slot is a header page followed by the page images */
+#define NODE_JOURNAL_NB_SLOTS           (FLASH_PAGES_PER_SECTOR / NODE_JOURNAL_SLOT_PAGES)      /*! Journaled mutations rotate through the slots of the sector */
+#define NODE_JOURNAL_MAGIC              0x4A4E  /*! Marks a journal header */
+
 // flags, prev & nextaddress bytes length
 #define FLAGS_PREV_NEXT_ADDR_LENGTH 6
 
@@ -213,6 +224,46 @@ typedef struct __attribute__((packed)) dataNode {
     uint8_t data[DATA_NODE_DATA_LENGTH];    /*!< 128 bytes of Large Data Store */
 } dNode;
 
+/*!
+* Struct containing the node journal header
+*
+* Note: Once written the journaled page images are copied to their pages, at the next boot if power is lost
+* Note: Once copied the header is rewritten with a null count, so that every slot header is rewritten as the slots rotate
+*/
+typedef struct __attribute__((packed)) nodeJournalH
+{
+    uint16_t magic;                             /*!< NODE_JOURNAL_MAGIC */
+    uint16_t sequence;                          /*!< Incremented at each journaled mutation, the last used slot has the highest one */
+    uint8_t count;                              /*!< Number of journaled pages, 0 once they are copied */
+    uint16_t pages[NODE_JOURNAL_MAX_PAGES];     /*!< Destination pages of the journaled images */
+    uint32_t crc;                               /*!< CRC-32 of the previous fields, a header partly programmed when power was lost is ignored */
+} nodeJournalHeader;
+
+/*!
+* Struct containing the user database check statistics
+*/
+typedef struct __attribute__((packed)) dbCheckS
+{
+    uint16_t nbNodes[4];                        /*!< Number of nodes reached in the lists, indexed by node type */
+    uint16_t nbOrphanNodes;                     /*!< Number of valid user nodes that aren't in any list */
+    uint16_t nbUnsortedNodes;                   /*!< Number of nodes that aren't sorted after their previous node */
+    uint16_t nbRepairedLinks;                   /*!< Number of links repaired */
+    uint16_t nbCrossLinks;                      /*!< Number of links to a node already linked from another list or list position, which aren't repaired */
+} dbCheckStats;
+
+/*!
+* Struct containing a user profile, as laid out in the user profile flash memory
+*/
+typedef struct __attribute__((packed)) userProfileS
+{
+    uint16_t startingParent;                /*!< The address of the users first parent node */
+    uint16_t favorites[USER_MAX_FAV][2];    /*!< The parent and child node addresses of the users favorites */
+    uint16_t dataStartingParent;            /*!< The address of the users first data parent node */
+    uint16_t allocationCursor;              /*!< The node address from which the free node search starts */
+    uint8_t ctr[USER_CTR_SIZE];             /*!< The users base CTR */
+    uint8_t dbChangeNumber;                 /*!< The user DB change number */
+} userProfile;
+
 /*!
 * Struct containing Node Management Handle
 *
@@ -228,8 +279,11 @@ typedef struct __attribute__((packed)) nodeMgmtH
     uint16_t firstDataParentNode;   /*!< The address of the users first data parent node (read from flash. eg cache) */
     uint16_t lastParentNode;        /*!< The address of the users last parent node (read from flash. eg cache) */
     uint16_t nextFreeNode;          /*!< The address of the next free node */
+    userProfile profile;            /*!< The users profile (read from flash at login, written through) */
     gNode tempgNode;                /*!< A generic node to be used as a buffer */
     uint16_t servicesLut[26];       /*!<Look up table for our services */
+    uint16_t lutNextParentNode;     /*!< The next parent node to scan to populate the LUT, NODE_ADDR_NULL once populated */
+    uint8_t lutLastLetter;          /*!< The first letter of the last parent node scanned to populate the LUT */
 } mgmtHandle;
 
 /**
@@ -308,12 +362,14 @@ void userProfileStartingOffset(uint8_t uid, uint16_t *page, uint16_t *pageOffset
 void setDataStartingParent(uint16_t dataParentAddress);
 void setStartingParent(uint16_t parentAddress);
 uint16_t getStartingDataParentAddress(void);
+uint16_t getNodeAllocationCursor(void);
 uint16_t getStartingParentAddress(void);
 uint16_t getLastParentAddress(void);
 
 nodeFirstCharAddr_t getPreviousNextFirstCharAddressForNode(uint16_t nodeAddress, char c, bool next);
 void getPreviousNextFirstLetterForGivenLetter(char c, char* array, uint16_t* parent_addresses);
 uint16_t getParentNodeForLetter(uint8_t letter);
+void populateServicesLutSlice(void);
 void populateServicesLut(void);
 
 void setFav(uint8_t favId, uint16_t parentAddress, uint16_t childAddress);
@@ -323,6 +379,7 @@ void setProfileCtr(void *buf);
 void readProfileCtr(void *buf);
 
 RET_TYPE createGenericNode(gNode* g, uint16_t firstNodeAddress, uint16_t* newFirstNodeAddress, uint8_t comparisonFieldOffset, uint8_t comparisonFieldLength);
+RET_TYPE relinkGenericNode(gNode* g, uint16_t nodeAddress, uint16_t firstNodeAddress, uint8_t comparisonFieldOffset, uint8_t comparisonFieldLength, uint16_t parentAddress);
 
 RET_TYPE writeNewDataNode(uint16_t context_parent_node_addr, pNode* parent_node_ptr, dNode* data_node_ptr, uint8_t first_data_block_flag, uint8_t last_packet_flag);
 RET_TYPE createParentNode(pNode* p, uint8_t type);
@@ -336,12 +393,23 @@ RET_TYPE invalidateChildNode(cNode *c);
 RET_TYPE createChildNode(uint16_t pAddr, cNode *c);
 RET_TYPE createChildStartOfDataNode(uint16_t pAddr, cNode *c, uint8_t dataNodeCount);
 void readChildNode(cNode *c, uint16_t childNodeAddress);
+void markChildNodeAsUsed(uint16_t childNodeAddress);
+void flushUsedChildNodesDates(void);
+void startNodeWriteBatch(uint8_t journal);
+void commitNodeWriteBatch(void);
+void recoverNodeJournal(void);
+void saveNodeAllocationCursor(void);
 RET_TYPE updateChildNode(pNode *p, cNode *c, uint16_t pAddr, uint16_t cAddr);
 RET_TYPE deleteChildNode(uint16_t pAddr, uint16_t cAddr, cNode *ic);
 
 void readNode(gNode* g, uint16_t nodeAddress);
 
 uint8_t findFreeNodes(uint8_t nbNodes, uint16_t* nodeArray, uint16_t startPage, uint8_t startNode);
+uint8_t findFreeNodesFromAddress(uint8_t nbNodes, uint16_t* nodeArray, uint16_t startAddress);
+uint16_t findFreeNodeRun(uint16_t nbNodes, uint16_t startAddress);
+uint32_t getNodeRangeDigest(uint16_t* address, uint16_t* nbSlots);
+void checkUserDatabase(dbCheckStats* stats);
+RET_TYPE mergeParentNode(pNode* p, uint16_t* cursor);
 RET_TYPE updateChildNodePassword(cNode* c, uint16_t cAddr, uint8_t* password, uint8_t* ctr_value);
 RET_TYPE updateChildNodeDescription(cNode* c, uint16_t cAddr, uint8_t* description);
 void setProfileUserDbChangeNumber(void *buf);
@@ -31,50 +31,111 @@
 #if defined(MINI_VERSION)
 
 
-/*! \fn     miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr)
+/*! \fn     miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint8_t flags, uint16_t addr)
  *  \brief  Initialise a bitstream ready for use
  *  \param  bs      pointer to the bitstream context to be used for the new bitmap
  *  \param  height  data height
  *  \param  width   data width
+ *  \param  flags   bitmap flags (BITSTREAM_FLAG_COMPRESSED for compressed data)
  *  \param  addr    address of the bitmap in SPI flash
  */
-void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr)
+void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint8_t flags, uint16_t addr)
 {
     // In the data storage height can be any value but one y line is stored in blocks of 8bits (eg: 10pixels height > 2 bytes)
     bs->addr = addr;
     bs->width = width;
+    bs->flags = flags;
     bs->height = height;
+    bs->srcCounter = 0;
     bs->dataCounter = 0;
+    bs->historyIndex = 0;
+    bs->blockRemaining = 0;
     bs->dataSize = (uint16_t)width * (((uint16_t)height+7) / BITSTREAM_PIXELS_PER_BYTE);
 }
 
-/*! \fn     bsGetNextByte(bitstream_mini_t* bs)
- *  \brief  Return the next data byte from flash
+/*! \fn     miniBistreamGetNextRawByte(bitstream_mini_t* bs)
+ *  \brief  Return the next stored byte from flash
+ *  \param  bs      pointer to initialized bitstream context
+ *  \return next stored byte
+ */
+static uint8_t miniBistreamGetNextRawByte(bitstream_mini_t* bs)
+{
+    uint8_t buffer_index = bs->srcCounter % sizeof(bs->buffer);
+
+    // Check if we need to fetch new data from the SPI flash
+    if (buffer_index == 0)
+    {
+        // Fetch new data from external flash
+        flashRawRead(bs->buffer, bs->addr + bs->srcCounter, sizeof(bs->buffer));
+        //usbPrintf_P(PSTR("bistream buffer: %02x %02x %02x %02x %02x %02x"), bs->buffer[0], bs->buffer[1], bs->buffer[2], bs->buffer[3], bs->buffer[4], bs->buffer[5]);
+    }
+    bs->srcCounter++;
+
+    return bs->buffer[buffer_index];
+}
+
+/*! \fn     miniBistreamGetNextByte(bitstream_mini_t* bs)
+ *  \brief  Return the next data byte, decompressing it if needed
  *  \param  bs      pointer to initialized bitstream context to get the next word from
- *  \return next data word, or 0 if end of data reached
+ *  \return next data byte, or 0 if end of data reached
  */
- uint8_t miniBistreamGetNextByte(bitstream_mini_t* bs)
- {
-     // Are you requesting bytes when you've already read everything?
-     if (bs->dataCounter < bs->dataSize)
-     {
-         uint16_t buffer_index = bs->dataCounter % sizeof(bs->buffer);
+uint8_t miniBistreamGetNextByte(bitstream_mini_t* bs)
+{
+    uint8_t data;
+
+    // Are you requesting bytes when you've already read everything?
+    if (bs->dataCounter >= bs->dataSize)
+    {
+        return 0;
+    }
+    bs->dataCounter++;
+
+    // Uncompressed data: stored bytes are the data bytes
+    if ((bs->flags & BITSTREAM_FLAG_COMPRESSED) == 0)
+    {
+        return miniBistreamGetNextRawByte(bs);
+    }
 
-         // Check if we need to fetch new data from the SPI flash
-         if(buffer_index == 0)
-         {
-             // Fetch new data from external flash
-             flashRawRead(bs->buffer, bs->addr + bs->dataCounter, sizeof(bs->buffer));
-             //usbPrintf_P(PSTR("bistream buffer: %02x %02x %02x %02x %02x %02x"), bs->buffer[0], bs->buffer[1], bs->buffer[2], bs->buffer[3], bs->buffer[4], bs->buffer[5]);
-         }
-         bs->dataCounter++;
+    // Start a new compressed block if needed
+    if (bs->blockRemaining == 0)
+    {
+        bs->blockControl = miniBistreamGetNextRawByte(bs);
+        if (bs->blockControl < BITSTREAM_CTRL_RUN)
+        {
+            bs->blockRemaining = bs->blockControl + 1;
+        }
+        else if (bs->blockControl < BITSTREAM_CTRL_BACKREF)
+        {
+            bs->blockRemaining = (bs->blockControl & 0x3F) + 2;
+            bs->blockValue = miniBistreamGetNextRawByte(bs);
+        }
+        else
+        {
+            bs->blockRemaining = ((bs->blockControl >> 3) & 0x0F) + 2;
+            bs->blockValue = (bs->blockControl & 0x07) + 1;
+        }
+    }
+    bs->blockRemaining--;
 
-         return bs->buffer[buffer_index];
-     }
-     else
-     {
-         return 0;
-     }
- }
+    // Decode the byte
+    if (bs->blockControl < BITSTREAM_CTRL_RUN)
+    {
+        data = miniBistreamGetNextRawByte(bs);
+    }
+    else if (bs->blockControl < BITSTREAM_CTRL_BACKREF)
+    {
+        data = bs->blockValue;
+    }
+    else
+    {
+        data = bs->history[(bs->historyIndex - bs->blockValue) & (BITSTREAM_HISTORY_SIZE - 1)];
+    }
+
+    // Store it for later back references
+    bs->history[bs->historyIndex] = data;
+    bs->historyIndex = (bs->historyIndex + 1) & (BITSTREAM_HISTORY_SIZE - 1);
+
+    return data;
+}
 #endif
 /***************************************************************/
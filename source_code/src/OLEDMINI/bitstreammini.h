@@ -31,6 +31,17 @@
 /** BIT STREAM DEFINES **/
 #define BITSTREAM_BUFFER_SIZE               16  // Bitstream buffer size
 #define BITSTREAM_PIXELS_PER_BYTE            8  // Number of pixels per byte
+#define BITSTREAM_HISTORY_SIZE               8  // Number of decoded bytes kept for back references, power of 2
+
+/** BITMAP FLAGS **/
+#define BITSTREAM_FLAG_COMPRESSED           0x02 // Bitmap data is compressed, see below
+
+/** COMPRESSED DATA CONTROL BYTES **/
+// 0b00nnnnnn: n+1 literal bytes follow
+// 0b01nnnnnn: the next byte is repeated n+2 times
+// 0b1nnnnddd: copy n+2 bytes from d+1 bytes back in the decoded data
+#define BITSTREAM_CTRL_RUN                  0x40
+#define BITSTREAM_CTRL_BACKREF              0x80
 
 /** STRUCTS **/
 typedef struct
@@ -39,12 +50,19 @@ typedef struct
     uint16_t width;             // number of pixels wide
     uint16_t dataSize;          // total data size
     uint16_t dataCounter;       // current counter
+    uint16_t srcCounter;        // number of bytes read from SPI FLASH
     uint16_t addr;              // address of data in SPI FLASH store
     uint8_t buffer[16];         // read ahead buffer
+    uint8_t flags;              // bitmap flags
+    uint8_t blockControl;       // control byte of the current compressed block
+    uint8_t blockRemaining;     // number of bytes left in the current compressed block
+    uint8_t blockValue;         // run value or back reference distance
+    uint8_t historyIndex;       // next write index in history
+    uint8_t history[BITSTREAM_HISTORY_SIZE];    // last decoded bytes
 } bitstream_mini_t;
 
 /** PROTOTYPES **/
 uint8_t miniBistreamGetNextByte(bitstream_mini_t* bs);
-void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr);
+void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint8_t flags, uint16_t addr);
 
 #endif /* BITSTREAMMINI_H_ */
\ No newline at end of file
@@ -795,7 +795,7 @@ void miniOledBitmapDrawFlash(int8_t x, int8_t y, uint8_t fileId, uint8_t options
     flashRawRead((uint8_t*)&bitmap, addr, sizeof(bitmap));
 
     // Initialize bitstream (pixel data starts right after the header)
-    miniBistreamInit(&bs, bitmap.height, bitmap.width, addr+sizeof(bitmap));
+    miniBistreamInit(&bs, bitmap.height, bitmap.width, bitmap.flags, addr+sizeof(bitmap));
 
     // Draw the bitmap
     if (y >= 0)
@@ -988,7 +988,7 @@ uint8_t miniOledGlyphDraw(uint8_t x, uint8_t y, char ch)
         OLEDDEBUGPRINTF_P(PSTR("    glyph '%c' width %d height %d xoffset %d yoffset %d addr 0x%04x\n"), ch, glyph_width, glyph_height, glyph.xoffset, glyph.yoffset, gaddr);
 
         // Initialize bitstream & draw the character
-        miniBistreamInit(&bs, glyph_height, glyph_width, gaddr);
+        miniBistreamInit(&bs, glyph_height, glyph_width, 0, gaddr);
         miniOledBitmapDrawRaw((int8_t)x, y, &bs);
     }
 
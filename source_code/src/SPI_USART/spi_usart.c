@@ -24,6 +24,7 @@
 
 #include "spi_usart.h"
 #include "spi_usart_private.h"
+#include "perf_counters.h"
 
 /**
  * Initialise the SPI USART interface to the specified data rate
@@ -58,6 +59,8 @@ void spi_usart_init(void)
  */
 uint8_t spi_usart_transfer_8(uint8_t data)
 {
+    PERF_COUNT(PERF_CNT_SPI_BYTES, 1);
+
     // Wait for empty transmit buffer
     while (!(UCSR1A & (1 << UDRE1)));
     UDR1 = data;
@@ -67,6 +70,67 @@ uint8_t spi_usart_transfer_8(uint8_t data)
     return UDR1;
 }
 
+/**
+ * Pipelined burst transfer: the transmit buffer is kept loaded one byte ahead
+ * so the shift register never idles, and RX is drained in lockstep.
+ * @param tx_data - pointer to the first byte to send, NULL to send zeros
+ * @param rx_data - pointer to where the first received byte is stored, NULL to discard
+ * @param size - number of bytes to transfer
+ * @param step - 1 to walk the buffers upwards (LSB first), -1 downwards (MSB first)
+ * @note tx_data and rx_data may point to the same buffer, a byte is always
+ * fetched before the previous one is overwritten
+ * @note All bytes have been shifted out when this function returns
+ */
+static void spi_usart_burst(uint8_t* tx_data, uint8_t* rx_data, size_t size, int8_t step)
+{
+    uint8_t tx_byte = 0x00;
+    uint8_t rx_byte;
+
+    if (size == 0)
+    {
+        return;
+    }
+    PERF_COUNT(PERF_CNT_SPI_BYTES, size);
+
+    // Prime the transmitter with the first byte
+    if (tx_data)
+    {
+        tx_byte = *tx_data;
+        tx_data += step;
+    }
+    while (!(UCSR1A & (1 << UDRE1)));
+    UDR1 = tx_byte;
+
+    while (--size)
+    {
+        // Queue the next byte while the previous one is being shifted
+        if (tx_data)
+        {
+            tx_byte = *tx_data;
+            tx_data += step;
+        }
+        while (!(UCSR1A & (1 << UDRE1)));
+        UDR1 = tx_byte;
+
+        // Fetch the byte received during the previous transmission
+        while (!(UCSR1A & (1 << RXC1)));
+        rx_byte = UDR1;
+        if (rx_data)
+        {
+            *rx_data = rx_byte;
+            rx_data += step;
+        }
+    }
+
+    // Fetch the last received byte
+    while (!(UCSR1A & (1 << RXC1)));
+    rx_byte = UDR1;
+    if (rx_data)
+    {
+        *rx_data = rx_byte;
+    }
+}
+
 /**
  * Send and receive a number of bytes via the SPI USART interface, LSB first
  * @param data - pointer to buffer of data to send
@@ -81,11 +145,7 @@ void spi_usart_transfer(uint8_t* data, size_t size) __attribute__((alias("spi_us
  */
 void spi_usart_transfer_lsb(uint8_t* data, size_t size)
 {
-    while (size--)
-    {
-        *data = spi_usart_transfer_8(*data);
-        data++;
-    }
+    spi_usart_burst(data, data, size, 1);
 }
 
 /**
@@ -95,10 +155,7 @@ void spi_usart_transfer_lsb(uint8_t* data, size_t size)
  */
 void spi_usart_transfer_msb(uint8_t* data, size_t size)
 {
-    while (size--)
-    {
-        *(data + size) = spi_usart_transfer_8(*(data + size));
-    }
+    spi_usart_burst(data + size - 1, data + size - 1, size, -1);
 }
 
 /**
@@ -124,10 +181,7 @@ void spi_usart_write(uint8_t* data, size_t size) __attribute__((alias("spi_usart
  */
 void spi_usart_write_lsb(uint8_t* data, size_t size)
 {
-    while (size--)
-    {
-        spi_usart_write_8(*data++);
-    }
+    spi_usart_burst(data, NULL, size, 1);
 }
 
 /**
@@ -137,10 +191,7 @@ void spi_usart_write_lsb(uint8_t* data, size_t size)
  */
 void spi_usart_write_msb(uint8_t* data, size_t size)
 {
-    while (size--)
-    {
-        spi_usart_write_8(*(data + size));
-    }
+    spi_usart_burst(data + size - 1, NULL, size, -1);
 }
 
 /**
@@ -166,10 +217,7 @@ void spi_usart_read(uint8_t* data, size_t size) __attribute__((alias("spi_usart_
  */
 void spi_usart_read_lsb(uint8_t* data, size_t size)
 {
-    while (size--)
-    {
-        *data++ = spi_usart_read_8();
-    }
+    spi_usart_burst(NULL, data, size, 1);
 }
 
 /**
@@ -179,8 +227,5 @@ void spi_usart_read_lsb(uint8_t* data, size_t size)
  */
 void spi_usart_read_msb(uint8_t* data, size_t size)
 {
-    while (size--)
-    {
-        *(data + size) = spi_usart_read_8();
-    }
+    spi_usart_burst(NULL, data + size - 1, size, -1);
 }
@@ -30,7 +30,7 @@ extern "C" {
 #endif
 
 // Software version
-#define SPI_USART_VERSION 112
+#define SPI_USART_VERSION 113
 
 #include <stdint.h>
 #include <stddef.h>
@@ -221,13 +221,14 @@ RET_TYPE initiateI2cRead(uint8_t addr, uint8_t reg)
     return RETURN_OK;
 }
 
-/*! \fn     readDataFromTS(uint8_t reg, uint8_t* data)
-*   \brief  Write a byte inside the AT42QT2120
-*   \param  reg         The register address
+/*! \fn     readBurstFromTS(uint8_t reg, uint8_t* data, uint8_t length)
+*   \brief  Read consecutive registers from the AT42QT2120 in one transaction (address auto-increment)
+*   \param  reg         The first register address
 *   \param  data        uint8_t pointer in which we write the data
+*   \param  length      The number of registers to read
 *   \return RETURN_OK if everything is alright, the pb code otherwise
 */
-RET_TYPE readDataFromTS(uint8_t reg, uint8_t* data)
+RET_TYPE readBurstFromTS(uint8_t reg, uint8_t* data, uint8_t length)
 {
     RET_TYPE ret_val;
 
@@ -237,6 +238,14 @@ RET_TYPE readDataFromTS(uint8_t reg, uint8_t* data)
         return ret_val;
     }
 
+    // Acknowledge all bytes but the last one
+    while (--length)
+    {
+        acknowledge_data();
+        waitForTwintFlag();
+        *data++ = TWDR;
+    }
+
     clear_twint_flag();
     waitForTwintFlag();
     *data = TWDR;
@@ -245,6 +254,17 @@ RET_TYPE readDataFromTS(uint8_t reg, uint8_t* data)
     return RETURN_OK;
 }
 
+/*! \fn     readDataFromTS(uint8_t reg, uint8_t* data)
+*   \brief  Read a byte from the AT42QT2120
+*   \param  reg         The register address
+*   \param  data        uint8_t pointer in which we write the data
+*   \return RETURN_OK if everything is alright, the pb code otherwise
+*/
+RET_TYPE readDataFromTS(uint8_t reg, uint8_t* data)
+{
+    return readBurstFromTS(reg, data, 1);
+}
+
 /*! \fn     initI2cPort()
 *   \brief  Initialize ports & i2c controller
 */
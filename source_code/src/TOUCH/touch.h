@@ -29,6 +29,7 @@
 #include "defines.h"
 
 // Prototypes
+RET_TYPE readBurstFromTS(uint8_t reg, uint8_t* data, uint8_t length);
 RET_TYPE readDataFromTS(uint8_t reg, uint8_t* data);
 RET_TYPE writeDataToTS(uint8_t reg, uint8_t data);
 void initI2cPort(void);
@@ -37,8 +37,18 @@
 uint8_t last_raw_wheel_position;
 // Touch inhibit bool
 uint8_t touch_inhibit = FALSE;
-// Last LED mask
-uint8_t last_led_mask;
+// Last values written to the LED registers
+uint8_t touch_led_states[NB_KEYS];
+// LED registers, indexed by touch position
+static const uint8_t touch_led_registers[NB_KEYS] __attribute__((__progmem__)) =
+{
+    WHEEL_TLEFT_LED_REGISTER,
+    WHEEL_TRIGHT_LED_REGISTER,
+    WHEEL_BLEFT_LED_REGISTER,
+    WHEEL_BRIGHT_LED_REGISTER,
+    RIGHT_LED_REGISTER,
+    LEFT_LED_REGISTER
+};
 // Touch sensing init
 static const uint8_t touch_init[] __attribute__((__progmem__)) = 
 {
@@ -130,6 +140,9 @@ RET_TYPE initTouchSensing(void)
             val = pgm_read_byte(&touch_init[i++]);
             writeDataToTS(reg, val);
         }
+        
+        // The init sequence switches all the LEDs on
+        memset((void*)touch_led_states, AT42QT2120_OUTPUT_H_VAL, NB_KEYS);
             
         // Custom sensitivity settings
         writeDataToTS(REG_AT42QT_DI, getMooltipassParameterInEeprom(TOUCH_DI_PARAM));                   // Increase detection integrator value
@@ -141,6 +154,24 @@ RET_TYPE initTouchSensing(void)
     return temp_return;
 }
 
+/*! \fn     touchSetLedState(uint8_t position, uint8_t state)
+*   \brief  Set the state of an LED, its register is only written if the state changed
+*   \param  position    The LED touch position
+*   \param  state       AT42QT2120_OUTPUT_H_VAL or AT42QT2120_OUTPUT_L_VAL
+*   \return TRUE if the register was written
+*/
+uint8_t touchSetLedState(uint8_t position, uint8_t state)
+{
+    if (touch_led_states[position] == state)
+    {
+        return FALSE;
+    }
+    
+    touch_led_states[position] = state;
+    writeDataToTS(pgm_read_byte(&touch_led_registers[position]), state);
+    return TRUE;
+}
+
 /*! \fn     getLastRawWheelPosition(void)
 *   \brief  Get the touched wheel position
 *   \return The position
@@ -179,11 +210,8 @@ uint8_t getWheelTouchDetectionQuarter(void)
 */
 void touchClearCurrentDetections(void)
 {
-    uint8_t temp_uint;
-    readDataFromTS(REG_AT42QT_SLIDER_POS, &temp_uint);
-    readDataFromTS(REG_AT42QT_DET_STAT, &temp_uint);    
-    readDataFromTS(REG_AT42QT_KEY_STAT1, &temp_uint);
-    readDataFromTS(REG_AT42QT_KEY_STAT2, &temp_uint);
+    uint8_t status_registers[AT42QT_STATUS_LENGTH];
+    readBurstFromTS(REG_AT42QT_DET_STAT, status_registers, sizeof(status_registers));
 }
 
 /*! \fn     touchWaitForButtonsReleased(void)
@@ -216,6 +244,7 @@ void touchInhibitUntilRelease(void)
 RET_TYPE touchDetectionRoutine(uint8_t led_mask)
 {
     RET_TYPE return_val = RETURN_NO_CHANGE;
+    uint8_t status_registers[AT42QT_STATUS_LENGTH];
     uint8_t keys_detection_status;
     uint8_t led_states[NB_KEYS];
     uint8_t temp_bool = FALSE;
@@ -235,20 +264,15 @@ RET_TYPE touchDetectionRoutine(uint8_t led_mask)
     
     if (isTouchChangeDetected())
     {
-        // Set temp bool to TRUE
-        temp_bool = TRUE;
-        
-        // Read detection status register
-        readDataFromTS(REG_AT42QT_DET_STAT, &keys_detection_status);
-        
-        // Unused byte that needs to be read        
-        readDataFromTS(REG_AT42QT_KEY_STAT1, &temp_uint);
+        // Read detection status, key status (first one is unused but needs to be read) and wheel position in one burst
+        readBurstFromTS(REG_AT42QT_DET_STAT, status_registers, sizeof(status_registers));
+        keys_detection_status = status_registers[REG_AT42QT_DET_STAT - REG_AT42QT_DET_STAT];
         
         // If wheel is touched
         if (keys_detection_status & AT42QT2120_SDET_MASK)
         {
-            // Get position and update global var
-            readDataFromTS(REG_AT42QT_SLIDER_POS, &last_raw_wheel_position);
+            // Update global var
+            last_raw_wheel_position = status_registers[REG_AT42QT_SLIDER_POS - REG_AT42QT_DET_STAT];
             
             // Update LED states
             led_states[getWheelTouchDetectionQuarter()] = AT42QT2120_OUTPUT_L_VAL;
@@ -259,8 +283,8 @@ RET_TYPE touchDetectionRoutine(uint8_t led_mask)
             return_val |= RETURN_WHEEL_RELEASED;
         }
 
-        // Read button touched register
-        readDataFromTS(REG_AT42QT_KEY_STAT2, &temp_uint);
+        // Button touched register
+        temp_uint = status_registers[REG_AT42QT_KEY_STAT2 - REG_AT42QT_DET_STAT];
         
         // If one button is touched
         if ((keys_detection_status & AT42QT2120_TDET_MASK) && !(keys_detection_status & AT42QT2120_SDET_MASK))
@@ -308,16 +332,14 @@ RET_TYPE touchDetectionRoutine(uint8_t led_mask)
         }
     }    
     
-    // If there's a touch change or led mask has changed
-    if ((temp_bool == TRUE) || (led_mask != last_led_mask))
+    // Only write the LED registers whose state changed
+    for (temp_uint = 0; temp_uint < NB_KEYS; temp_uint++)
+    {
+        temp_bool |= touchSetLedState(temp_uint, led_states[temp_uint]);
+    }
+    
+    if (temp_bool == TRUE)
     {
-        last_led_mask = led_mask;
-        writeDataToTS(LEFT_LED_REGISTER, led_states[TOUCHPOS_LEFT]);
-        writeDataToTS(RIGHT_LED_REGISTER, led_states[TOUCHPOS_RIGHT]);
-        writeDataToTS(WHEEL_TLEFT_LED_REGISTER, led_states[TOUCHPOS_WHEEL_TLEFT]);
-        writeDataToTS(WHEEL_TRIGHT_LED_REGISTER, led_states[TOUCHPOS_WHEEL_TRIGHT]);
-        writeDataToTS(WHEEL_BLEFT_LED_REGISTER, led_states[TOUCHPOS_WHEEL_BLEFT]);
-        writeDataToTS(WHEEL_BRIGHT_LED_REGISTER,  led_states[TOUCHPOS_WHEEL_BRIGHT]);
         // In some rare cases LED state changes can create detections. In that case we add a small delay
         timerBasedDelayMs(2);
         touchClearCurrentDetections();
@@ -35,6 +35,7 @@ void activateProxDetection(void);
 void launchCalibrationCycle(void);
 void touchInhibitUntilRelease(void);
 void touchWaitForButtonsReleased(void);
+uint8_t touchSetLedState(uint8_t position, uint8_t state);
 uint8_t getLastRawWheelPosition(void);
 void touchClearCurrentDetections(void);
 uint8_t getWheelTouchDetectionQuarter(void);
@@ -60,6 +61,7 @@ RET_TYPE touchDetectionRoutine(uint8_t led_mask);
 #define REG_AT42QT_KEY_STAT1        0x03
 #define REG_AT42QT_KEY_STAT2        0x04
 #define REG_AT42QT_SLIDER_POS       0x05
+#define AT42QT_STATUS_LENGTH        4       // DET_STAT to SLIDER_POS, read in one burst
 #define REG_AT42QT_CALIB            0x06
 #define REG_AT42QT_nRESET           0x07
 #define REG_AT42QT_LP               0x08
@@ -169,18 +171,18 @@ RET_TYPE touchDetectionRoutine(uint8_t led_mask);
 #else
     #define isTouchChangeDetected() FALSE
 #endif
-#define switchOnLeftButonLed()      writeDataToTS(LEFT_LED_REGISTER, AT42QT2120_OUTPUT_H_VAL)
-#define switchOffLeftButonLed()     writeDataToTS(LEFT_LED_REGISTER, AT42QT2120_OUTPUT_L_VAL)
-#define switchOnRightButonLed()     writeDataToTS(RIGHT_LED_REGISTER, AT42QT2120_OUTPUT_H_VAL)
-#define switchOffRightButonLed()    writeDataToTS(RIGHT_LED_REGISTER, AT42QT2120_OUTPUT_L_VAL)
-#define switchOnTopLeftWheelLed()   writeDataToTS(WHEEL_TLEFT_LED_REGISTER, AT42QT2120_OUTPUT_H_VAL)
-#define switchOffTopLeftWheelLed()  writeDataToTS(WHEEL_TLEFT_LED_REGISTER, AT42QT2120_OUTPUT_L_VAL)
-#define switchOnTopRightWheelLed()  writeDataToTS(WHEEL_TRIGHT_LED_REGISTER, AT42QT2120_OUTPUT_H_VAL)
-#define switchOffTopRightWheelLed() writeDataToTS(WHEEL_TRIGHT_LED_REGISTER, AT42QT2120_OUTPUT_L_VAL)
-#define switchOnBotLeftWheelLed()   writeDataToTS(WHEEL_BLEFT_LED_REGISTER, AT42QT2120_OUTPUT_H_VAL)
-#define switchOffBotLeftWheelLed()  writeDataToTS(WHEEL_BLEFT_LED_REGISTER, AT42QT2120_OUTPUT_L_VAL)
-#define switchOnBotRightWheelLed()  writeDataToTS(WHEEL_BRIGHT_LED_REGISTER, AT42QT2120_OUTPUT_H_VAL)
-#define switchOffBotRightWheelLed() writeDataToTS(WHEEL_BRIGHT_LED_REGISTER, AT42QT2120_OUTPUT_L_VAL)
+#define switchOnLeftButonLed()      touchSetLedState(TOUCHPOS_LEFT, AT42QT2120_OUTPUT_H_VAL)
+#define switchOffLeftButonLed()     touchSetLedState(TOUCHPOS_LEFT, AT42QT2120_OUTPUT_L_VAL)
+#define switchOnRightButonLed()     touchSetLedState(TOUCHPOS_RIGHT, AT42QT2120_OUTPUT_H_VAL)
+#define switchOffRightButonLed()    touchSetLedState(TOUCHPOS_RIGHT, AT42QT2120_OUTPUT_L_VAL)
+#define switchOnTopLeftWheelLed()   touchSetLedState(TOUCHPOS_WHEEL_TLEFT, AT42QT2120_OUTPUT_H_VAL)
+#define switchOffTopLeftWheelLed()  touchSetLedState(TOUCHPOS_WHEEL_TLEFT, AT42QT2120_OUTPUT_L_VAL)
+#define switchOnTopRightWheelLed()  touchSetLedState(TOUCHPOS_WHEEL_TRIGHT, AT42QT2120_OUTPUT_H_VAL)
+#define switchOffTopRightWheelLed() touchSetLedState(TOUCHPOS_WHEEL_TRIGHT, AT42QT2120_OUTPUT_L_VAL)
+#define switchOnBotLeftWheelLed()   touchSetLedState(TOUCHPOS_WHEEL_BLEFT, AT42QT2120_OUTPUT_H_VAL)
+#define switchOffBotLeftWheelLed()  touchSetLedState(TOUCHPOS_WHEEL_BLEFT, AT42QT2120_OUTPUT_L_VAL)
+#define switchOnBotRightWheelLed()  touchSetLedState(TOUCHPOS_WHEEL_BRIGHT, AT42QT2120_OUTPUT_H_VAL)
+#define switchOffBotRightWheelLed() touchSetLedState(TOUCHPOS_WHEEL_BRIGHT, AT42QT2120_OUTPUT_L_VAL)
 #define switchOffButtonWheelLeds()  switchOffLeftButonLed(); switchOffRightButonLed(); switchOffTopLeftWheelLed(); switchOffTopRightWheelLed(); switchOffBotLeftWheelLed(); switchOffBotRightWheelLed();
 #define switchOnButtonWheelLeds()   switchOnLeftButonLed(); switchOnRightButonLed();  switchOnTopLeftWheelLed(); switchOnTopRightWheelLed(); switchOnBotLeftWheelLed(); switchOnBotRightWheelLed();
 
@@ -22,6 +22,7 @@
 #include "usb_descriptors.h"
 #include "usb_cmd_parser.h"
 #include "timer_manager.h"
+#include "perf_counters.h"
 #include "logic_eeprom.h"
 #include "oled_wrapper.h"
 #include "hid_defines.h"
@@ -65,6 +66,24 @@ static uint8_t keyboard_idle_count = 0;
 // 1=num lock, 2=caps lock, 4=scroll lock, 8=compose, 16=kana
 volatile uint8_t keyboard_leds = 0;
 
+// Raw HID reception ring, filled by the endpoint interrupt and drained by usbRawHidRecv
+static uint8_t usb_rx_ring[USB_RX_RING_SIZE][RAWHID_RX_SIZE];
+// Index of the next slot to be filled by the interrupt
+static volatile uint8_t usb_rx_ring_write_index = 0;
+// Index of the next slot to be read
+static volatile uint8_t usb_rx_ring_read_index = 0;
+// Number of reports in the ring
+static volatile uint8_t usb_rx_ring_count = 0;
+
+// Raw HID transmission queue, filled by usbHidSend and drained by the endpoint interrupt
+static uint8_t usb_tx_queue[USB_TX_QUEUE_SIZE][RAWHID_TX_SIZE];
+// Index of the next slot to be filled
+static volatile uint8_t usb_tx_queue_write_index = 0;
+// Index of the next slot to be sent by the interrupt
+static volatile uint8_t usb_tx_queue_read_index = 0;
+// Number of reports in the queue
+static volatile uint8_t usb_tx_queue_count = 0;
+
 // Endpoint configuration table
 static const uint8_t PROGMEM endpoint_config_table[] =
 {
@@ -212,54 +231,102 @@ uint8_t getKeyboardLeds(void)
     return keyboard_leds;
 }
 
-/*! \fn     usbRawHidRecv(uint8_t *buffer, uint8_t timeout)
-*   \brief  Receive a packet, with timeout
+/*! \fn     usbRawHidRecv(uint8_t *buffer)
+*   \brief  Fetch a packet received by the endpoint interrupt, non blocking
 *   \param  buffer    Pointer to the buffer to store received data
-*   \return RETURN_COM_TRANSF_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT
+*   \return RETURN_COM_TRANSF_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT (nothing received)
 */
 RET_TYPE usbRawHidRecv(uint8_t *buffer)
 {
     uint8_t intr_state;
-    uint8_t i = 0;
 
     // if we're not online (enumerated and configured), error
     if (!usb_configuration)
     {
         return RETURN_COM_NOK;
     }
+    // check if a packet is waiting in the ring
+    if (usb_rx_ring_count == 0)
+    {
+        return RETURN_COM_TIMEOUT;
+    }
+    // the interrupt doesn't touch a slot until we release it
+    memcpy(buffer, usb_rx_ring[usb_rx_ring_read_index], RAWHID_RX_SIZE);
+    if (++usb_rx_ring_read_index == USB_RX_RING_SIZE)
+    {
+        usb_rx_ring_read_index = 0;
+    }
+    // release the slot and re-enable the reception interrupt in case the ring was full
     intr_state = SREG;
     cli();
-    // Activate timeout timer
-    activateTimer(TIMER_WAIT_FUNCTS, USB_READ_TIMEOUT);
+    usb_rx_ring_count--;
     UENUM = RAWHID_RX_ENDPOINT;
-    // wait for data to be available in the FIFO
-    while (1)
+    UEIENX = (1<<RXOUTE);
+    SREG = intr_state;
+    PERF_COUNT(PERF_CNT_USB_REPORTS_IN, 1);
+    return RETURN_COM_TRANSF_OK;
+}
+
+/*! \fn     usbRawHidRxInterrupt(void)
+*   \brief  Move a received raw HID packet from the endpoint bank to the reception ring
+*   \note   Called from the endpoint interrupt. When the ring is full the interrupt is disabled
+*           and the packet stays in the endpoint, so the host gets NAKed until usbRawHidRecv frees a slot
+*/
+static inline void usbRawHidRxInterrupt(void)
+{
+    uint8_t* ring_slot;
+    uint8_t i;
+
+    UENUM = RAWHID_RX_ENDPOINT;
+    if (usb_rx_ring_count == USB_RX_RING_SIZE)
     {
-        if (UEINTX & (1<<RWAL))
-        {
-            break;
-        }
-        SREG = intr_state;
-        if (hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) == TIMER_EXPIRED)
-        {
-            return RETURN_COM_TIMEOUT;
-        }
-        if (!usb_configuration)
-        {
-            return RETURN_COM_NOK;
-        }
-        intr_state = SREG;
-        cli();
-        UENUM = RAWHID_RX_ENDPOINT;
+        UEIENX = 0;
+        return;
     }
-    for(i = 0; i < RAWHID_RX_SIZE; i++)
+    ring_slot = usb_rx_ring[usb_rx_ring_write_index];
+    for (i = 0; i < RAWHID_RX_SIZE; i++)
     {
-        *buffer++ = UEDATX;
+        *ring_slot++ = UEDATX;
     }
-    // release the buffer
+    // release the bank
     UEINTX = 0x6B;
-    SREG = intr_state;
-    return RETURN_COM_TRANSF_OK;
+    if (++usb_rx_ring_write_index == USB_RX_RING_SIZE)
+    {
+        usb_rx_ring_write_index = 0;
+    }
+    usb_rx_ring_count++;
+}
+
+/*! \fn     usbRawHidTxInterrupt(void)
+*   \brief  Move the oldest queued raw HID packet to a free endpoint bank
+*   \note   Called from the endpoint interrupt, which is masked once the queue is empty
+*/
+static inline void usbRawHidTxInterrupt(void)
+{
+    uint8_t* queue_slot;
+    uint8_t i;
+
+    UENUM = RAWHID_TX_ENDPOINT;
+    if (usb_tx_queue_count == 0)
+    {
+        UEIENX = 0;
+        return;
+    }
+    queue_slot = usb_tx_queue[usb_tx_queue_read_index];
+    for (i = 0; i < RAWHID_TX_SIZE; i++)
+    {
+        UEDATX = *queue_slot++;
+    }
+    // transmit it now
+    UEINTX = 0x3A;
+    if (++usb_tx_queue_read_index == USB_TX_QUEUE_SIZE)
+    {
+        usb_tx_queue_read_index = 0;
+    }
+    if (--usb_tx_queue_count == 0)
+    {
+        UEIENX = 0;
+    }
 }
 
 
@@ -338,9 +405,9 @@ static inline void usb_ack_out(void)
 }
 
 /*! \fn     ISR(USB_COM_vect)
-*   \brief  USB Endpoint Interrupt - endpoint 0 is handled here.  The
-*           other endpoints are manipulated by the user-callable
-*           functions, and the start-of-frame interrupt.
+*   \brief  USB Endpoint Interrupt - endpoint 0 and raw HID reception
+*           are handled here.  The other endpoints are manipulated by
+*           the user-callable functions, and the start-of-frame interrupt.
 */
 ISR(USB_COM_vect)
 {
@@ -357,6 +424,22 @@ ISR(USB_COM_vect)
     const uint8_t *desc_addr;
     uint8_t desc_length;
 
+    // Raw HID packet received
+    if (UEINT & (1<<RAWHID_RX_ENDPOINT))
+    {
+        usbRawHidRxInterrupt();
+    }
+    // Raw HID endpoint bank free
+    if (UEINT & (1<<RAWHID_TX_ENDPOINT))
+    {
+        usbRawHidTxInterrupt();
+    }
+    // return if there's nothing to do for the control endpoint
+    if (!(UEINT & (1<<0)))
+    {
+        return;
+    }
+
     UENUM = 0;
     intbits = UEINTX;
     if (intbits & (1<<RXSTPI))
@@ -457,6 +540,18 @@ ISR(USB_COM_vect)
             }
             UERST = 0x1E;
             UERST = 0;
+            // empty the reception ring and enable the raw HID reception interrupt
+            usb_rx_ring_write_index = 0;
+            usb_rx_ring_read_index = 0;
+            usb_rx_ring_count = 0;
+            UENUM = RAWHID_RX_ENDPOINT;
+            UEIENX = (1<<RXOUTE);
+            // empty the transmission queue
+            usb_tx_queue_write_index = 0;
+            usb_tx_queue_read_index = 0;
+            usb_tx_queue_count = 0;
+            UENUM = RAWHID_TX_ENDPOINT;
+            UEIENX = 0;
             return;
         }
         if (bRequest == GET_CONFIGURATION && bmRequestType == 0x80)
@@ -624,61 +719,53 @@ ISR(USB_COM_vect)
 }
 
 /*!
-*   \brief  Wait for the TX fifo to be ready to accept data.
-*   \param  intr_state   pointer to storage to save the interrupt state
-*   \retval RETURN_TRANSF_COM_OK fifo is ready, and interrupts are disabled
-*   \retval RETURN_COM_TIMEOUT timeout waiting for fifo to be ready
+*   \brief  Wait for a slot to be free in the transmission queue
+*   \retval RETURN_TRANSF_COM_OK a slot is free
+*   \retval RETURN_COM_TIMEOUT timeout waiting for the queue to be drained
 *   \retval RETURN_COM_NOK USB not configured
 */
-static RET_TYPE usbWaitFifoReady(uint8_t *intr_state)
+static RET_TYPE usbWaitTxQueueSlot(void)
 {
     // if we're not online (enumerated and configured), error
     if (!usb_configuration)
     {
         return RETURN_COM_NOK;
     }
-    *intr_state = SREG;
-    cli();
     // Activate timeout timer
     activateTimer(TIMER_WAIT_FUNCTS, USB_WRITE_TIMEOUT);
-    UENUM = RAWHID_TX_ENDPOINT;
-    // wait for the FIFO to be ready to accept data
-    while (1)
+    PERF_TIMESTAMP(wait_start);
+    // wait for the interrupt to move a packet to the endpoint
+    while (usb_tx_queue_count == USB_TX_QUEUE_SIZE)
     {
-        if (UEINTX & (1<<RWAL))
-        {
-            break;
-        }
-        SREG = *intr_state;
         if (hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) == TIMER_EXPIRED)
         {
+            PERF_ADD_ELAPSED(PERF_CNT_USB_WAIT_US, wait_start);
             return RETURN_COM_TIMEOUT;
         }
         if (!usb_configuration)
         {
             return RETURN_COM_NOK;
         }
-        *intr_state = SREG;
-        cli();
-        UENUM = RAWHID_TX_ENDPOINT;
     }
+    PERF_ADD_ELAPSED(PERF_CNT_USB_WAIT_US, wait_start);
     return RETURN_COM_TRANSF_OK;
 }
 
-
 /*!
-*   \brief  Send a packet, with timeout
+*   \brief  Queue a packet for transmission, waiting for a free slot with timeout
 *           If cmd is non-zero then the lenght and cmd byte are
 *           sent first, followed by the buffer.
 *           If cmd is zero, the buffer is sent as-is.
-*   \param  cmd       optional command byte to send. Ignored if 0
-*   \param  buffer    Pointer to the buffer to send data from
-*   \param  buflen    amount of data to send from buffer
+*   \param  cmd             optional command byte to send. Ignored if 0
+*   \param  buffer          Pointer to the data to send
+*   \param  buflen          amount of data to send from buffer
+*   \param  buffer_in_flash TRUE if buffer points to program memory
 *   \return RETURN_TRANSF_COM_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT
 */
-RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
+static RET_TYPE usbHidQueuePacket(uint8_t cmd, const void *buffer, uint8_t buflen, uint8_t buffer_in_flash)
 {
     uint8_t intr_state;
+    uint8_t* queue_slot;
     int8_t res, rem;
     
     // How many bytes to add to send a full packet
@@ -698,39 +785,65 @@ RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
         return RETURN_COM_NOK;
     }
 
-    res = usbWaitFifoReady(&intr_state);
+    res = usbWaitTxQueueSlot();
 
     if (res != RETURN_COM_TRANSF_OK) 
     {
         return res;
     }
 
+    // the interrupt doesn't touch the slot until it is committed
+    queue_slot = usb_tx_queue[usb_tx_queue_write_index];
     if (cmd)
     {
-        UEDATX = buflen;
-        UEDATX = cmd;
+        *queue_slot++ = buflen;
+        *queue_slot++ = cmd;
     }
 
-    // write bytes to the FIFO
-    while (buflen--)
+    // copy the data and make up the remainder
+    if (buffer_in_flash == FALSE)
     {
-        UEDATX = *(uint8_t *)buffer++;
+        memcpy(queue_slot, buffer, buflen);
     }
+    else
+    {
+        memcpy_P(queue_slot, buffer, buflen);
+    }
+    memset(queue_slot + buflen, 0, rem);
 
-    // make up the remainder
-    while (rem--)
+    if (++usb_tx_queue_write_index == USB_TX_QUEUE_SIZE)
     {
-        UEDATX = 0;
+        usb_tx_queue_write_index = 0;
     }
 
-    // transmit it now
-    UEINTX = 0x3A;
+    // commit the slot and let the interrupt transmit it as soon as a bank is free
+    intr_state = SREG;
+    cli();
+    usb_tx_queue_count++;
+    UENUM = RAWHID_TX_ENDPOINT;
+    UEIENX = (1<<TXINE);
     SREG = intr_state;
+    PERF_COUNT(PERF_CNT_USB_REPORTS_OUT, 1);
     return RETURN_COM_TRANSF_OK;
 }
 
 /*!
-*   \brief  Send a packet, with timeout
+*   \brief  Queue a packet for transmission, with timeout
+*           If cmd is non-zero then the lenght and cmd byte are
+*           sent first, followed by the buffer.
+*           If cmd is zero, the buffer is sent as-is.
+*   \param  cmd       optional command byte to send. Ignored if 0
+*   \param  buffer    Pointer to the buffer to send data from
+*   \param  buflen    amount of data to send from buffer
+*   \return RETURN_TRANSF_COM_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT
+*/
+RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
+{
+    return usbHidQueuePacket(cmd, buffer, buflen, FALSE);
+}
+
+/*!
+*   \brief  Queue a packet for transmission, with timeout
 *           If cmd is non-zero then the lenght and cmd byte are
 *           sent first, followed by the buffer.
 *           If cmd is zero, the buffer is sent as-is.
@@ -741,55 +854,7 @@ RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
 */
 RET_TYPE usbHidSend_P(uint8_t cmd, const void *buffer, uint8_t buflen)
 {
-    uint8_t intr_state;
-    int8_t res, rem;
-    
-    // How many bytes to add to send a full packet
-    if (cmd)
-    {
-        // If there is a command, the first 2 bytes are taken
-        rem = PACKET_EXPORT_SIZE - buflen;
-    }
-    else
-    {
-        rem = RAWHID_TX_SIZE - buflen;
-    }
-
-    // Check that we don't want to send too many bytes
-    if (rem < 0)
-    {
-        return RETURN_COM_NOK;
-    }
-
-    res = usbWaitFifoReady(&intr_state);
-
-    if (res != RETURN_COM_TRANSF_OK)
-    {
-        return res;
-    }
-
-    if (cmd)
-    {
-        UEDATX = buflen;
-        UEDATX = cmd;
-    }
-
-    // write bytes to the FIFO
-    while (buflen--)
-    {
-        UEDATX = pgm_read_byte(buffer++);
-    }
-
-    // make up the remainder
-    while (rem--)
-    {
-        UEDATX = 0;
-    }
-
-    // transmit it now
-    UEINTX = 0x3A;
-    SREG = intr_state;
-    return RETURN_COM_TRANSF_OK;
+    return usbHidQueuePacket(cmd, buffer, buflen, TRUE);
 }
 
 /*! \fn     usbRawHidSend(uint8_t *buffer, uint8_t timeout)
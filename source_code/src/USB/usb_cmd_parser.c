@@ -35,6 +35,7 @@
 #include "logic_smartcard.h"
 #include "usb_cmd_parser.h"
 #include "timer_manager.h"
+#include "perf_counters.h"
 #include "oled_wrapper.h"
 #include "logic_eeprom.h"
 #include "hid_defines.h"
@@ -49,6 +50,7 @@
 #include <stdio.h>
 #include "delays.h"
 #include "utils.h"
+#include "scheduler.h"
 #include "stack.h"
 #include "usb.h"
 #include "rng.h"
@@ -59,6 +61,8 @@ volatile uint8_t memoryManagementModeApproved = FALSE;
 uint8_t mediaFlashImportApproved = FALSE;
 // Current node we're writing
 uint16_t currentNodeWritten = NODE_ADDR_NULL;
+// Page held in the flash buffer 2 as programmed by the last completed node write, NODE_WRITE_BATCH_NO_PAGE if unknown
+uint16_t nodeWriteBufferPage = NODE_WRITE_BATCH_NO_PAGE;
 // Media flash import temp page
 uint16_t mediaFlashImportPage;
 // Media flash import temp offset
@@ -68,6 +72,8 @@ extern uint8_t __stack;
 /* External var, end of known static RAM (to be filled by linker) */
 extern uint8_t _end;
 
+static void usbProcessMessage(uint8_t caller_id, uint8_t* incomingData);
+
 /*! \fn     checkMooltipassPassword(uint8_t* data)
 *   \brief  Check that the provided bytes is the mooltipass password
 *   \param  data            Password to be checked
@@ -111,6 +117,7 @@ uint8_t checkMooltipassPassword(uint8_t* data, void* addr, uint8_t length)
 */
 void leaveMemoryManagementMode(void)
 {
+    nodeWriteBufferPage = NODE_WRITE_BATCH_NO_PAGE;
     #if defined(LEDS_ENABLED_MINI)
         miniLedsSetAnimation(ANIM_NONE);
     #endif
@@ -197,6 +204,25 @@ void usbProcessIncoming(uint8_t caller_id)
         return;
     }
 
+#ifdef PERF_COUNTERS
+    // The command field may be overwritten while servicing the message
+    uint8_t datacmd = incomingData[HID_TYPE_FIELD];
+    perfTimestamp_t cmd_start;
+    perfGetTimestamp(&cmd_start);
+    usbProcessMessage(caller_id, incomingData);
+    perfRecordCommand(datacmd, &cmd_start);
+#else
+    usbProcessMessage(caller_id, incomingData);
+#endif
+}
+
+/*! \fn     usbProcessMessage(uint8_t caller_id, uint8_t* incomingData)
+*   \brief  Process a received USB packet
+*   \param  caller_id       UID of the calling function
+*   \param  incomingData    Pointer to the received packet, also used as a temporary buffer
+*/
+static void usbProcessMessage(uint8_t caller_id, uint8_t* incomingData)
+{
     // Temp plugin return value, error by default
     uint8_t plugin_return_value = PLUGIN_BYTE_ERROR;
 
@@ -217,6 +243,13 @@ void usbProcessIncoming(uint8_t caller_id)
     // Debug comms
     // USBDEBUGPRINTF_P(PSTR("usb: rx cmd 0x%02x len %u\n"), datacmd, datalen);
 
+    // Called from a blocking loop: the command handler may already be running, ask to retry later
+    if ((caller_id == USB_CALLER_YIELD) && (datacmd != CMD_MOOLTIPASS_STATUS))
+    {
+        usbSendMessage(CMD_PLEASE_RETRY, 0, incomingData);
+        return;
+    }
+
     // Check if we're currently asking the user to enter his PIN or want to query the MP status
     if ((caller_id == USB_CALLER_PIN) || (datacmd == CMD_MOOLTIPASS_STATUS))
     {
@@ -287,13 +320,19 @@ void usbProcessIncoming(uint8_t caller_id)
     }
 
     // Check that we are in node mangement mode when needed
-    if ((datacmd >= FIRST_CMD_FOR_DATAMGMT) && (datacmd <= LAST_CMD_FOR_DATAMGMT) && (memoryManagementModeApproved == FALSE))
+    if ((((datacmd >= FIRST_CMD_FOR_DATAMGMT) && (datacmd <= LAST_CMD_FOR_DATAMGMT)) || ((datacmd >= FIRST_CMD_FOR_DATAMGMT2) && (datacmd <= LAST_CMD_FOR_DATAMGMT2))) && (memoryManagementModeApproved == FALSE))
     {
         // Return an error that was defined before (ERROR)
         usbSendMessage(datacmd, 1, &plugin_return_value);
         return;
     }
 
+    // Other commands may use the flash buffer 2 or modify the page it holds
+    if (datacmd != CMD_WRITE_FLASH_NODE)
+    {
+        nodeWriteBufferPage = NODE_WRITE_BATCH_NO_PAGE;
+    }
+
     // Otherwise, process command
     switch(datacmd)
     {
@@ -615,6 +654,7 @@ void usbProcessIncoming(uint8_t caller_id)
                         guiSetCurrentScreen(SCREEN_MEMORY_MGMT);
                         plugin_return_value = PLUGIN_BYTE_OK;
                         memoryManagementModeApproved = TRUE;
+                        resetCredentialBatch();
                         #if defined(LEDS_ENABLED_MINI)
                             miniLedsSetAnimation(ANIM_TURN_AROUND);
                         #endif
@@ -685,6 +725,93 @@ void usbProcessIncoming(uint8_t caller_id)
             }
         }
 
+        // Get the first address of a contiguous free node slot run
+        case CMD_GET_FREE_NODE_RUN :
+        {
+            // Check that the start address and the number of slots have been provided
+            if (datalen == 4)
+            {
+                // Memory management mode check implemented before the switch
+                uint16_t* temp_args_ptr = (uint16_t*)msg->body.data;
+                uint16_t run_address = findFreeNodeRun(temp_args_ptr[1], temp_args_ptr[0]);
+
+                // Send address
+                usbSendMessage(CMD_GET_FREE_NODE_RUN, 2, (uint8_t*)&run_address);
+                return;
+            }
+            else
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+                break;
+            }
+        }
+
+        // Get the digest of a node slot range
+        case CMD_GET_NODE_DIGEST :
+        {
+            // Check that the start address and the number of slots have been provided
+            if (datalen == 4)
+            {
+                // Memory management mode check implemented before the switch
+                uint16_t* temp_args_ptr = (uint16_t*)msg->body.data;
+                uint16_t digest_answer[4];
+
+                // Answer: CRC-32, address following the range, number of slots scanned
+                digest_answer[2] = temp_args_ptr[0];
+                digest_answer[3] = temp_args_ptr[1];
+                *(uint32_t*)digest_answer = getNodeRangeDigest(&digest_answer[2], &digest_answer[3]);
+                usbSendMessage(CMD_GET_NODE_DIGEST, sizeof(digest_answer), (uint8_t*)digest_answer);
+                return;
+            }
+            else
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+                break;
+            }
+        }
+
+        // Check and repair the user database
+        case CMD_CHECK_DB :
+        {
+            // Memory management mode check implemented before the switch
+            dbCheckStats check_stats;
+
+            checkUserDatabase(&check_stats);
+            usbSendMessage(CMD_CHECK_DB, sizeof(check_stats), (uint8_t*)&check_stats);
+            return;
+        }
+
+        // Store a field of a credential batch
+        case CMD_STORE_CRED_BATCH :
+        {
+            // Memory management mode check implemented before the switch
+            uint8_t max_field_size;
+
+            if (msg->body.data[0] == BATCH_FIELD_SERVICE)
+            {
+                max_field_size = NODE_PARENT_SIZE_OF_SERVICE;
+            }
+            else if (msg->body.data[0] == BATCH_FIELD_LOGIN)
+            {
+                max_field_size = NODE_CHILD_SIZE_OF_LOGIN;
+            }
+            else
+            {
+                max_field_size = NODE_CHILD_SIZE_OF_PASSWORD;
+            }
+
+            // Field ID followed by the string
+            if ((datalen > 1) && (checkTextField(&msg->body.data[1], datalen-1, max_field_size) == RETURN_OK) && (storeCredentialBatchField(msg->body.data[0], &msg->body.data[1], datalen-1) == RETURN_OK))
+            {
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            else
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+            }
+            break;
+        }
+
         // End memory management mode
         case CMD_END_MEMORYMGMT :
         {
@@ -894,7 +1021,15 @@ void usbProcessIncoming(uint8_t caller_id)
                     if(checkUserPermission(*temp_node_addr_ptr) == RETURN_OK)
                     {
                         currentNodeWritten = *temp_node_addr_ptr;
-                        loadPageToInternalBuffer(pageNumberFromAddress(currentNodeWritten));
+
+                        // The buffer may already hold the page as programmed by the previous node
+                        if (pageNumberFromAddress(currentNodeWritten) != nodeWriteBufferPage)
+                        {
+                            loadPageToInternalBuffer(pageNumberFromAddress(currentNodeWritten));
+                        }
+
+                        // Until this node is complete the buffer doesn't match the page anymore
+                        nodeWriteBufferPage = NODE_WRITE_BATCH_NO_PAGE;
                     }
                 }
 
@@ -910,10 +1045,11 @@ void usbProcessIncoming(uint8_t caller_id)
                     // Fill the data at the right place
                     flashWriteBuffer(msg->body.data + 3, (NODE_SIZE * nodeNumberFromAddress(currentNodeWritten)) + (msg->body.data[2] * (PACKET_EXPORT_SIZE-3)), datalen - 3);
 
-                    // If we finished writing, flush buffer
+                    // If we finished writing, program the page before acknowledging, the buffer then still holds it for the next node
                     if (msg->body.data[2] == (NODE_SIZE/(PACKET_EXPORT_SIZE-3)))
                     {
                         flashWriteBufferToPage(pageNumberFromAddress(currentNodeWritten));
+                        nodeWriteBufferPage = pageNumberFromAddress(currentNodeWritten);
                     }
 
                     plugin_return_value = PLUGIN_BYTE_OK;
@@ -1525,6 +1661,51 @@ void usbProcessIncoming(uint8_t caller_id)
         }
 #endif
 
+        // Performance counters commands
+#ifdef PERF_COUNTERS
+        case CMD_GET_PERF_COUNTERS:
+        {
+            // First byte is the page, second byte the command slot for the command statistics page
+            if ((datalen >= 1) && (msg->body.data[0] == PERF_PAGE_COUNTERS))
+            {
+                usbSendMessage(CMD_GET_PERF_COUNTERS, sizeof(perf_counters), (void*)perf_counters);
+                return;
+            }
+            else if ((datalen >= 1) && (msg->body.data[0] == PERF_PAGE_TASKS))
+            {
+                // Max latency and number of deadline misses for each scheduler task
+                uint16_t answer[2*NUMBER_OF_TASKS];
+                for (uint8_t i = 0; i < NUMBER_OF_TASKS; i++)
+                {
+                    answer[2*i] = schedulerGetTaskMaxLatency(i);
+                    answer[2*i+1] = schedulerGetTaskDeadlineMisses(i);
+                }
+                usbSendMessage(CMD_GET_PERF_COUNTERS, sizeof(answer), answer);
+                return;
+            }
+            else if ((datalen >= 2) && (msg->body.data[0] == PERF_PAGE_COMMAND))
+            {
+                // Command ID, number of calls, min / max / total service time in us
+                perfCmdStats_t stats;
+                if (perfGetCommandStats(msg->body.data[1], &stats) == RETURN_OK)
+                {
+                    usbSendMessage(CMD_GET_PERF_COUNTERS, sizeof(stats), &stats);
+                    return;
+                }
+            }
+            plugin_return_value = PLUGIN_BYTE_ERROR;
+            break;
+        }
+
+        case CMD_RESET_PERF_COUNTERS:
+        {
+            perfResetCounters();
+            schedulerResetTaskStatistics();
+            plugin_return_value = PLUGIN_BYTE_OK;
+            break;
+        }
+#endif
+
         // Development commands
 #ifdef  DEV_PLUGIN_COMMS
         // erase eeprom
@@ -9,6 +9,9 @@
 #define BUNDLE_UPLOAD_TIMEOUT   60000
 
 /* USB mooltipass hid commands */
+// Performance counters commands
+#define CMD_GET_PERF_COUNTERS   0x88
+#define CMD_RESET_PERF_COUNTERS 0x89
 // Developper plugin commands
 #define CMD_TEST_ACC_PRESENCE   0x95
 #define CMD_ERASE_EEPROM        0x96
@@ -86,6 +89,17 @@
 #define CMD_SET_DESCRIPTION     0xD8
 #define CMD_LOCK_DEVICE         0xD9
 #define CMD_UNLOCK_WITH_PIN     0xDA
+#define CMD_GET_NODE_DIGEST     0xDB
+#define CMD_CHECK_DB            0xDC
+#define CMD_STORE_CRED_BATCH    0xDD
+#define CMD_GET_FREE_NODE_RUN   0xDE
+#define FIRST_CMD_FOR_DATAMGMT2 CMD_GET_NODE_DIGEST
+#define LAST_CMD_FOR_DATAMGMT2  CMD_GET_FREE_NODE_RUN
+
+/* CMD_STORE_CRED_BATCH fields */
+#define BATCH_FIELD_SERVICE     0x00
+#define BATCH_FIELD_LOGIN       0x01
+#define BATCH_FIELD_PASSWORD    0x02
 
 
 /* Packet format defines     */
@@ -106,6 +120,7 @@
 /* function caller IDs */
 #define USB_CALLER_MAIN     0x00
 #define USB_CALLER_PIN      0x01
+#define USB_CALLER_YIELD    0x02
 
 /*** MACROS ***/
 #ifdef CMD_PARSER_USB_DEBUG_OUTPUT
@@ -20,9 +20,17 @@
 /*! \file   utils.c
 *   \brief  Useful functions
 */
+#include <avr/pgmspace.h>
 #include "mooltipass.h"
 #include "utils.h"
 
+// CRC-32 (IEEE 802.3, reflected) lookup table, one entry per nibble
+static const uint32_t PROGMEM crc32_nibble_table[16] =
+{
+    0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL, 0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+    0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL, 0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+};
+
 
 /*! \fn     swap16(uint16_t val)
 *   \brief  Swap low and high bytes
@@ -258,4 +266,23 @@ uint8_t hm_uint8_strncmp(uint8_t* buffer1, uint8_t* buffer2, uint8_t nb_chars)
 	}
 	
 	return 0;
+}
+
+/*! \fn     crc32_update(uint32_t crc, uint8_t* data, uint16_t length)
+*   \brief  Update a CRC-32 with a buffer, same output as zlib's crc32()
+*   \param  crc     Current CRC value, 0 for the first buffer
+*   \param  data    Pointer to the data
+*   \param  length  Number of bytes
+*   \return The updated CRC value
+*/
+uint32_t crc32_update(uint32_t crc, uint8_t* data, uint16_t length)
+{
+    crc = ~crc;
+    while (length--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ pgm_read_dword(&crc32_nibble_table[crc & 0x0F]);
+        crc = (crc >> 4) ^ pgm_read_dword(&crc32_nibble_table[crc & 0x0F]);
+    }
+    return ~crc;
 }
\ No newline at end of file
@@ -46,6 +46,7 @@ void clear_string(char* string, int nb_char);
 unsigned char chr_strlen(char* string);
 unsigned int int_strlen(char* string);
 char numchar_to_char(unsigned char c);
+uint32_t crc32_update(uint32_t crc, uint8_t* data, uint16_t length);
 uint16_t swap16(uint16_t val);
 char upper(char c);
 
@@ -40,6 +40,8 @@
 #define start_firmware()        asm volatile ("jmp 0x0000")
 #define MAX_FIRMWARE_SIZE       28672
 #define SPM_PAGE_SIZE_BYTES_BM  (SPM_PAGESIZE - 1)
+#define SEGMENTED_BUNDLE_MAGIC  "MPSEGMAC"
+#define SEGMENTED_MAGIC_LENGTH  8
 
 
 /*! \fn     start(void)
@@ -130,12 +132,18 @@ int main(void)
     aes256_context temp_aes_context;                                                                                    // AES context
     RET_TYPE flash_init_result;                                                                                         // Flash initialization result
     uint8_t cur_cbc_mac[16];                                                                                            // Current CBCMAC val
+    uint8_t fw_cbc_mac[16];                                                                                             // Firmware segment CBCMAC val
+    uint8_t fw_cur_cbc_mac[16];                                                                                         // Current firmware segment CBCMAC val, computed during the first pass
+    uint8_t segmented_bundle_bool = FALSE;                                                                              // Boolean specifying that the bundle has a firmware segment CBCMAC
     uint8_t temp_data[16];                                                                                              // Temporary 16 bytes array
     uint8_t aes_key_update_bool;                                                                                        // Boolean specifying that we want to update the aes key
     uint8_t old_version_number[4];                                                                                      // Old firmware version identifier
     uint8_t new_version_number[4];                                                                                      // New firmware version identifier
     uint16_t firmware_start_address = UINT16_MAX - MAX_FIRMWARE_SIZE - sizeof(cur_cbc_mac) - sizeof(cur_aes_key) + 1;   // Start address of firmware in external memory
     uint16_t firmware_end_address = UINT16_MAX - sizeof(cur_cbc_mac) - sizeof(cur_aes_key) + 1;                         // End address of firmware in external memory
+    uint16_t cbc_mac_start_address = GRAPHIC_ZONE_START;                                                                // Start address of the CBCMAC computation for the current pass
+    uint16_t cbc_mac_end_address = UINT16_MAX - sizeof(cur_cbc_mac) + 1;                                                // End address of the CBCMAC computation for the current pass
+    uint8_t* expected_cbc_mac = temp_data;                                                                              // Expected CBCMAC for the current pass
 
 
     /* The firmware uses the watchdog timer to get here */
@@ -196,6 +204,8 @@ int main(void)
     }
 
     /* Update bundle composition: bundle | padding | firmware version | new aes key bool | firmware | padding | new aes key encoded | cbcmac */
+    /* Segmented bundle composition: bundle | padding | firmware cbcmac | padding | magic | firmware version | new aes key bool | firmware | padding | new aes key encoded | cbcmac */
+    /* The first pass checks the cbcmac over the whole bundle, the second pass programs the firmware and checks the cbcmac over the version block + firmware if the bundle is segmented */
     for (uint8_t pass_number = 0; pass_number < 2; pass_number++)
     {
         /* Init CBCMAC encryption context and read current firmware version ID */
@@ -205,18 +215,32 @@ int main(void)
         aes256_init_ecb(&temp_aes_context, cur_aes_key);                                                                // Init AES context
         aes_key_update_bool = FALSE;                                                                                    // Set to False
 
-        // Compute CBCMAC for between the start of the graphics zone until the max addressing space (65536) - the size of the CBCMAC
-        for (uint16_t i = GRAPHIC_ZONE_START; i < (UINT16_MAX - sizeof(cur_cbc_mac) + 1); i += sizeof(cur_cbc_mac))
+        // Compute CBCMAC for between the start of the graphics zone until the max addressing space (65536) - the size of the CBCMAC, or over the version block and the firmware for the second pass of a segmented bundle
+        // Single continuous read of the external flash for the whole pass, nothing else uses the SPI bus meanwhile
+        flash_read_stream_start(cbc_mac_start_address);
+        for (uint16_t i = cbc_mac_start_address; i < cbc_mac_end_address; i += sizeof(cur_cbc_mac))
         {
             // Read data from external flash
-            flashRawRead(temp_data, i, sizeof(temp_data));
+            flash_read_stream(temp_data, sizeof(temp_data));
+
+            // 32 bytes before the firmware: firmware segment cbcmac, only used after the authenticated first pass
+            if (i == (firmware_start_address - 32))
+            {
+                memcpy(fw_cbc_mac, temp_data, sizeof(fw_cbc_mac));
+            }
 
             // 16 bytes before the firmware
             if (i == (firmware_start_address - 16))
             {
-                // 16 bytes before the firmware: padding | version number (4 bytes) | aes key update bool (1 byte)
+                // 16 bytes before the firmware: padding | segmented bundle magic (8 bytes) | version number (4 bytes) | aes key update bool (1 byte)
                 memcpy(new_version_number, temp_data + (16 - sizeof(aes_key_update_bool) - sizeof(new_version_number)), sizeof(new_version_number));
                 aes_key_update_bool = temp_data[16-sizeof(aes_key_update_bool)];
+                if (memcmp(temp_data + (16 - sizeof(aes_key_update_bool) - sizeof(new_version_number) - SEGMENTED_MAGIC_LENGTH), SEGMENTED_BUNDLE_MAGIC, SEGMENTED_MAGIC_LENGTH) == 0)
+                {
+                    // Candidate segmented bundle, its firmware segment CBCMAC is checked during this pass
+                    memset((void*)fw_cur_cbc_mac, 0x00, sizeof(fw_cur_cbc_mac));
+                    segmented_bundle_bool = TRUE;
+                }
             }
 
             // If we got to the part containing to firmware
@@ -243,12 +267,23 @@ int main(void)
             // Continue computation of CBCMAC
             aesXorVectors(cur_cbc_mac, temp_data, sizeof(temp_data));
             aes256_encrypt_ecb(&temp_aes_context, cur_cbc_mac);
+
+            // First pass of a candidate segmented bundle: also compute the firmware segment CBCMAC over the version block and the firmware
+            if ((pass_number == 0) && (segmented_bundle_bool != FALSE) && (i >= (firmware_start_address - 16)) && (i < firmware_end_address))
+            {
+                aesXorVectors(fw_cur_cbc_mac, temp_data, sizeof(temp_data));
+                aes256_encrypt_ecb(&temp_aes_context, fw_cur_cbc_mac);
+            }
         }
+        flash_read_stream_stop();
 
         // Read & compare CBCMAC, check that the version number is above or egal to our current one to set the update condition boolean
         uint8_t update_condition = TRUE;
-        flashRawRead(temp_data, (UINT16_MAX - sizeof(cur_cbc_mac) + 1), sizeof(cur_cbc_mac));
-        if ((sideChannelSafeMemCmp(temp_data, cur_cbc_mac, sizeof(cur_cbc_mac)) != 0) || (memcmp((void*)old_version_number, (void*)new_version_number, sizeof(new_version_number)) > 0))
+        if (expected_cbc_mac == temp_data)
+        {
+            flashRawRead(temp_data, (UINT16_MAX - sizeof(cur_cbc_mac) + 1), sizeof(cur_cbc_mac));
+        }
+        if ((sideChannelSafeMemCmp(expected_cbc_mac, cur_cbc_mac, sizeof(cur_cbc_mac)) != 0) || (memcmp((void*)old_version_number, (void*)new_version_number, sizeof(new_version_number)) > 0))
         {
             update_condition = FALSE;
         }
@@ -266,9 +301,16 @@ int main(void)
                 eeprom_write_word((uint16_t*)EEP_BOOTKEY_ADDR, CORRECT_BOOTKEY);                                                // Allow starting of the main firmware
                 start_firmware();                                                                                               // Start firmware
             }
+            else if ((segmented_bundle_bool != FALSE) && (sideChannelSafeMemCmp(fw_cur_cbc_mac, fw_cbc_mac, sizeof(fw_cbc_mac)) == 0))
+            {
+                // Next pass over the version block and the firmware, checked against the firmware segment CBCMAC authenticated by this pass
+                cbc_mac_start_address = firmware_start_address - 16;
+                cbc_mac_end_address = firmware_end_address;
+                expected_cbc_mac = fw_cbc_mac;
+            }
             else
             {
-                // Otherwise, next pass!
+                // Otherwise, next pass over the whole bundle
             }
         }
         else
@@ -128,6 +128,7 @@
     #define ENABLE_MOOLTIPASS_CARD_FORMATTING
 #elif defined(PRODUCTION_TEST_SETUP)
     //#define STACK_DEBUG
+    //#define PERF_COUNTERS
     #define FLASH_CHIP_4M
     #define TWO_CAPS_TRICK
     #define DATA_STORAGE_EN
@@ -26,7 +26,6 @@
 #include "mini_inputs.h"
 #include "interrupts.h"
 #include "smartcard.h"
-#include "mini_leds.h"
 
 // Number of milliseconds since power up
 #ifdef ENABLE_MILLISECOND_DBG_TIMER
@@ -44,9 +43,6 @@ ISR(TIMER1_COMPA_vect)                                              // Match on
     #if defined(MINI_VERSION)
         scanMiniInputsDetect();                                     // Scan mini inputs
     #endif
-    #if defined(LEDS_ENABLED_MINI)
-        miniLedsAnimationTick();                                    // LED animation
-    #endif
     #ifdef ENABLE_MILLISECOND_DBG_TIMER
         msecTicks++;                                                // Increment ms timer
     #endif
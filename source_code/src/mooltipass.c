@@ -48,8 +48,10 @@
 #include "mini_inputs.h"
 #include "mooltipass.h"
 #include "interrupts.h"
+#include "scheduler.h"
 #include "smartcard.h"
 #include "mini_leds.h"
+#include "node_mgmt.h"
 #include "flash_mem.h"
 #include "defines.h"
 #include "delays.h"
@@ -103,6 +105,161 @@ void reboot_platform(void)
     while(1);
 }
 
+/*! \fn     mainUsbTask(void)
+*   \brief  Main loop task: process possible incoming USB packets
+*   \note   From a blocking loop, only the status is answered and the host is asked to retry
+*/
+static void mainUsbTask(void)
+{
+    if (schedulerIsYieldRun() != FALSE)
+    {
+        usbProcessIncoming(USB_CALLER_YIELD);
+    }
+    else
+    {
+        usbProcessIncoming(USB_CALLER_MAIN);
+    }
+}
+
+/*! \fn     mainInputsTask(void)
+*   \brief  Main loop task: smartcard insertion / removal and caps lock wake up
+*/
+static void mainInputsTask(void)
+{
+    /* Check if a card just got inserted / removed */
+    RET_TYPE card_detect_ret = isCardPlugged();
+
+    /* Do appropriate actions on smartcard insertion / removal */
+    if (card_detect_ret == RETURN_JDETECT)
+    {
+        /* Light up the Mooltipass and call the dedicated function */
+        activityDetectedRoutine();
+        handleSmartcardInserted();
+    }
+    else if (card_detect_ret == RETURN_JRELEASED)
+    {
+        /* Light up the Mooltipass and call the dedicated function */
+        activityDetectedRoutine();
+        handleSmartcardRemoved();
+
+        /* Lock shortcut, if enabled */
+        if ((mp_lock_unlock_shortcuts != FALSE) && ((getMooltipassParameterInEeprom(LOCK_UNLOCK_FEATURE_PARAM) & LF_WIN_L_SEND_MASK) != 0))
+        {
+            usbSendLockShortcut();
+            mp_lock_unlock_shortcuts = FALSE;
+        }
+
+        /* Set correct screen */
+        guiDisplayInformationOnScreenAndWait(ID_STRING_CARD_REMOVED);
+        guiSetCurrentScreen(SCREEN_DEFAULT_NINSERTED);
+        guiGetBackToCurrentScreen();
+    }
+
+    #ifdef TWO_CAPS_TRICK
+    /* Two quick caps lock presses wakes up the device */
+    if ((hasTimerExpired(TIMER_CAPS, FALSE) == TIMER_EXPIRED) && (getKeyboardLeds() & HID_CAPS_MASK) && (wasCapsLockTimerArmed == FALSE))
+    {
+        wasCapsLockTimerArmed = TRUE;
+        activateTimer(TIMER_CAPS, CAPS_LOCK_DEL);
+    }
+    else if ((hasTimerExpired(TIMER_CAPS, FALSE) == TIMER_RUNNING) && !(getKeyboardLeds() & HID_CAPS_MASK))
+    {
+        if (isScreenSaverOn() == TRUE)
+        {
+            guiGetBackToCurrentScreen();
+        }
+        activityDetectedRoutine();
+    }
+    else if ((hasTimerExpired(TIMER_CAPS, FALSE) == TIMER_EXPIRED) && !(getKeyboardLeds() & HID_CAPS_MASK))
+    {
+        wasCapsLockTimerArmed = FALSE;
+    }
+    #endif
+}
+
+/*! \fn     mainLutTask(void)
+*   \brief  Main loop task: populate the services LUT in the background after login
+*/
+static void mainLutTask(void)
+{
+    if (getSmartCardInsertedUnlocked() == TRUE)
+    {
+        populateServicesLutSlice();
+    }
+}
+
+/*! \fn     mainGuiTask(void)
+*   \brief  Main loop task: GUI, screen saver and locking conditions
+*/
+static void mainGuiTask(void)
+{
+    /* Mooltipass mini: reboot platform if needed */
+    #if defined(MINI_VERSION) && !defined(MINI_CLICK_BETATESTERS_SETUP)
+        if(hasTimerExpired(TIMER_REBOOT, TRUE) == TIMER_EXPIRED)
+        {
+            reboot_platform();
+        }
+    #endif
+
+    /* Launch activity detected routine if flag is set */
+    if (act_detected_flag != FALSE)
+    {
+        if (isScreenSaverOn() == TRUE)
+        {
+            guiGetBackToCurrentScreen();
+        }
+        activityDetectedRoutine();
+        act_detected_flag = FALSE;
+    }
+
+    #if defined(HARDWARE_OLIVIER_V1)
+        /* Call GUI routine once the touch input inhibit timer is finished */
+        if (hasTimerExpired(TIMER_TOUCH_INHIBIT, FALSE) == TIMER_EXPIRED)
+        {
+            guiMainLoop();
+        }
+    #else
+        guiMainLoop();
+    #endif
+
+    /* If we are running the screen saver */
+    if (isScreenSaverOn() == TRUE)
+    {
+        #ifndef MINI_DEMO_VIDEO
+            animScreenSaver();
+        #endif
+    }
+
+    /* If the USB bus is in suspend (computer went to sleep), lock device */
+    if ((hasTimerExpired(TIMER_USB_SUSPEND, TRUE) == TIMER_EXPIRED) && (getSmartCardInsertedUnlocked() == TRUE))
+    {
+        handleSmartcardRemoved();
+        guiDisplayInformationOnScreenAndWait(ID_STRING_PC_SLEEP);
+        guiSetCurrentScreen(SCREEN_DEFAULT_INSERTED_LCK);
+        /* If the screen saver is on, clear screen contents */
+        if(isScreenSaverOn() == TRUE)
+        {
+            #ifndef MINI_VERSION
+                oledClear();
+                oledDisplayOtherBuffer();
+                oledClear();
+            #endif
+        }
+        else
+        {
+            guiGetBackToCurrentScreen();
+        }
+    }
+
+    /* If we have a timeout lock */
+    if ((mp_timeout_enabled == TRUE) && (hasTimerExpired(SLOW_TIMER_LOCKOUT, TRUE) == TIMER_EXPIRED))
+    {
+        guiSetCurrentScreen(SCREEN_DEFAULT_INSERTED_LCK);
+        guiGetBackToCurrentScreen();
+        handleSmartcardRemoved();
+    }
+}
+
 /*! \fn     main(void)
 *   \brief  Main function
 */
@@ -117,7 +274,6 @@ int main(void)
         RET_TYPE mini_inputs_result;                                                        // Mooltipass mini input initialization result
     #endif                                                                                  //
     RET_TYPE flash_init_result;                                                             // Flash initialization result
-    RET_TYPE card_detect_ret;                                                               // Card detection result
     uint8_t fuse_ok = TRUE;                                                                 // Fuse check result
 
     /********************************************************************/
@@ -226,6 +382,7 @@ int main(void)
     #endif                                      //
     #if defined(LEDS_ENABLED_MINI)              // Only for the pre-production mini
         miniInitLeds();                         // Initialize the LEDs
+        schedulerRegisterTask(TASK_LEDS, miniLedsAnimationTick, TASK_LEDS_PERIOD, TASK_LEDS_DEADLINE, TASK_FLAG_NESTABLE);
     #endif                                      //
     initPortSMC();                              // Initialize smart card port
     initIRQ();                                  // Initialize interrupts
@@ -287,6 +444,14 @@ int main(void)
         flash_erase_chip();                     // Erase everything in flash
         firstTimeUserHandlingInit();            // Erase # of cards and # of users
     }
+    smcUidLutIndexInit();                       // Build the RAM index of the smartcard <> user LUT
+
+    /** NODE JOURNAL RECOVERY **/
+    // Complete a node mutation interrupted by a power loss
+    if (flash_init_result == RETURN_OK)
+    {
+        recoverNodeJournal();
+    }
 
     /** TOUCH PANEL INITIALIZATION **/
     #if defined(HARDWARE_OLIVIER_V1)
@@ -411,125 +576,14 @@ int main(void)
         miniWheelClearDetections();
     #endif
 
+    /* Register the main loop tasks, by decreasing priority */
+    schedulerRegisterTask(TASK_USB, mainUsbTask, TASK_USB_PERIOD, TASK_USB_DEADLINE, TASK_FLAG_NESTABLE);
+    schedulerRegisterTask(TASK_INPUTS, mainInputsTask, TASK_INPUTS_PERIOD, TASK_INPUTS_DEADLINE, TASK_FLAG_NONE);
+    schedulerRegisterTask(TASK_GUI, mainGuiTask, TASK_GUI_PERIOD, TASK_GUI_DEADLINE, TASK_FLAG_NONE);
+    schedulerRegisterTask(TASK_LUT, mainLutTask, TASK_LUT_PERIOD, TASK_LUT_DEADLINE, TASK_FLAG_NONE);
+
     while (1)
     {
-        /* Process possible incoming USB packets */
-        usbProcessIncoming(USB_CALLER_MAIN);
-
-        /* Mooltipass mini: reboot platform if needed */
-        #if defined(MINI_VERSION) && !defined(MINI_CLICK_BETATESTERS_SETUP)
-            if(hasTimerExpired(TIMER_REBOOT, TRUE) == TIMER_EXPIRED)
-            {
-                reboot_platform();
-            }
-        #endif
-
-        /* Launch activity detected routine if flag is set */
-        if (act_detected_flag != FALSE)
-        {
-            if (isScreenSaverOn() == TRUE)
-            {
-                guiGetBackToCurrentScreen();
-            }
-            activityDetectedRoutine();
-            act_detected_flag = FALSE;
-        }
-
-        #if defined(HARDWARE_OLIVIER_V1)
-            /* Call GUI routine once the touch input inhibit timer is finished */
-            if (hasTimerExpired(TIMER_TOUCH_INHIBIT, FALSE) == TIMER_EXPIRED)
-            {
-                guiMainLoop();
-            }
-        #else
-            guiMainLoop();
-        #endif
-
-        /* If we are running the screen saver */
-        if (isScreenSaverOn() == TRUE)
-        {
-            #ifndef MINI_DEMO_VIDEO
-                animScreenSaver();
-            #endif
-        }
-
-        /* If the USB bus is in suspend (computer went to sleep), lock device */
-        if ((hasTimerExpired(TIMER_USB_SUSPEND, TRUE) == TIMER_EXPIRED) && (getSmartCardInsertedUnlocked() == TRUE))
-        {
-            handleSmartcardRemoved();
-            guiDisplayInformationOnScreenAndWait(ID_STRING_PC_SLEEP);
-            guiSetCurrentScreen(SCREEN_DEFAULT_INSERTED_LCK);
-            /* If the screen saver is on, clear screen contents */
-            if(isScreenSaverOn() == TRUE)
-            {
-                #ifndef MINI_VERSION
-                    oledClear();
-                    oledDisplayOtherBuffer();
-                    oledClear();
-                #endif
-            }
-            else
-            {
-                guiGetBackToCurrentScreen();
-            }
-        }
-
-        /* Check if a card just got inserted / removed */
-        card_detect_ret = isCardPlugged();
-
-        /* Do appropriate actions on smartcard insertion / removal */
-        if (card_detect_ret == RETURN_JDETECT)
-        {
-            /* Light up the Mooltipass and call the dedicated function */
-            activityDetectedRoutine();
-            handleSmartcardInserted();
-        }
-        else if (card_detect_ret == RETURN_JRELEASED)
-        {
-            /* Light up the Mooltipass and call the dedicated function */
-            activityDetectedRoutine();
-            handleSmartcardRemoved();
-
-            /* Lock shortcut, if enabled */
-            if ((mp_lock_unlock_shortcuts != FALSE) && ((getMooltipassParameterInEeprom(LOCK_UNLOCK_FEATURE_PARAM) & LF_WIN_L_SEND_MASK) != 0))
-            {
-                usbSendLockShortcut();
-                mp_lock_unlock_shortcuts = FALSE;
-            }
-
-            /* Set correct screen */
-            guiDisplayInformationOnScreenAndWait(ID_STRING_CARD_REMOVED);
-            guiSetCurrentScreen(SCREEN_DEFAULT_NINSERTED);
-            guiGetBackToCurrentScreen();
-        }
-
-        #ifdef TWO_CAPS_TRICK
-        /* Two quick caps lock presses wakes up the device */
-        if ((hasTimerExpired(TIMER_CAPS, FALSE) == TIMER_EXPIRED) && (getKeyboardLeds() & HID_CAPS_MASK) && (wasCapsLockTimerArmed == FALSE))
-        {
-            wasCapsLockTimerArmed = TRUE;
-            activateTimer(TIMER_CAPS, CAPS_LOCK_DEL);
-        }
-        else if ((hasTimerExpired(TIMER_CAPS, FALSE) == TIMER_RUNNING) && !(getKeyboardLeds() & HID_CAPS_MASK))
-        {
-            if (isScreenSaverOn() == TRUE)
-            {
-                guiGetBackToCurrentScreen();
-            }
-            activityDetectedRoutine();
-        }
-        else if ((hasTimerExpired(TIMER_CAPS, FALSE) == TIMER_EXPIRED) && !(getKeyboardLeds() & HID_CAPS_MASK))
-        {
-            wasCapsLockTimerArmed = FALSE;
-        }
-        #endif
-
-        /* If we have a timeout lock */
-        if ((mp_timeout_enabled == TRUE) && (hasTimerExpired(SLOW_TIMER_LOCKOUT, TRUE) == TIMER_EXPIRED))
-        {
-            guiSetCurrentScreen(SCREEN_DEFAULT_INSERTED_LCK);
-            guiGetBackToCurrentScreen();
-            handleSmartcardRemoved();
-        }
+        schedulerRunPendingTasks();
     }
 }
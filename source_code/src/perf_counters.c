@@ -0,0 +1,142 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     perf_counters.c
+*    \brief    Optional performance counters
+*    Created:  19/10/2026
+*    Author:   agent
+*/
+#include <util/atomic.h>
+#include <string.h>
+#include <avr/io.h>
+#include "perf_counters.h"
+#include "timer_manager.h"
+#include "defines.h"
+#ifdef PERF_COUNTERS
+
+// TIMER1 runs at 2MHz and is cleared every ms, see interrupts.c
+#define PERF_SUB_TICKS_PER_MS   2000
+#define PERF_SUB_TICKS_PER_US   2
+
+// Event counters
+uint32_t perf_counters[PERF_NB_COUNTERS];
+// USB command service times
+perfCmdStats_t perf_cmd_stats[PERF_NB_CMD_SLOTS];
+
+
+/*! \fn     perfResetCounters(void)
+*   \brief  Reset all the performance counters
+*/
+void perfResetCounters(void)
+{
+    memset((void*)perf_counters, 0x00, sizeof(perf_counters));
+    memset((void*)perf_cmd_stats, 0x00, sizeof(perf_cmd_stats));
+}
+
+/*! \fn     perfGetTimestamp(perfTimestamp_t* timestamp)
+*   \brief  Get the current time with a TIMER1 resolution
+*   \param  timestamp   Pointer to the timestamp to fill
+*/
+void perfGetTimestamp(perfTimestamp_t* timestamp)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        timestamp->ms = getSystemTick();
+        timestamp->sub_tick = TCNT1;
+
+        // The counter may have been cleared before the tick got incremented
+        if ((TIFR1 & (1 << OCF1A)) && (timestamp->sub_tick < (PERF_SUB_TICKS_PER_MS/2)))
+        {
+            timestamp->ms++;
+        }
+    }
+}
+
+/*! \fn     perfGetElapsedUs(perfTimestamp_t* start)
+*   \brief  Get the number of us elapsed since a given timestamp
+*   \param  start       Pointer to the start timestamp
+*   \return The number of us, valid for up to 65 seconds
+*/
+uint32_t perfGetElapsedUs(perfTimestamp_t* start)
+{
+    perfTimestamp_t now;
+
+    perfGetTimestamp(&now);
+    return ((uint32_t)(uint16_t)(now.ms - start->ms) * 1000) + ((int16_t)(now.sub_tick - start->sub_tick) / PERF_SUB_TICKS_PER_US);
+}
+
+/*! \fn     perfRecordCommand(uint8_t cmd, perfTimestamp_t* start)
+*   \brief  Record the service time of a USB command
+*   \param  cmd         The command ID
+*   \param  start       Pointer to the timestamp taken when the command was received
+*   \note   The first commands seen get their own slot, the others share the last one
+*/
+void perfRecordCommand(uint8_t cmd, perfTimestamp_t* start)
+{
+    uint32_t elapsed = perfGetElapsedUs(start);
+    perfCmdStats_t* stats = &perf_cmd_stats[PERF_NB_CMD_SLOTS-1];
+
+    for (uint8_t i = 0; i < PERF_NB_CMD_SLOTS-1; i++)
+    {
+        if ((perf_cmd_stats[i].cmd == cmd) || (perf_cmd_stats[i].count == 0))
+        {
+            stats = &perf_cmd_stats[i];
+            break;
+        }
+    }
+
+    if (stats == &perf_cmd_stats[PERF_NB_CMD_SLOTS-1])
+    {
+        cmd = PERF_CMD_SLOT_OTHER;
+    }
+
+    if ((stats->count == 0) || (elapsed < stats->min_us))
+    {
+        stats->min_us = elapsed;
+    }
+    if (elapsed > stats->max_us)
+    {
+        stats->max_us = elapsed;
+    }
+    if (stats->count != UINT16_MAX)
+    {
+        stats->count++;
+        stats->total_us += elapsed;
+    }
+    stats->cmd = cmd;
+}
+
+/*! \fn     perfGetCommandStats(uint8_t slot, perfCmdStats_t* stats)
+*   \brief  Get the service time statistics of a command slot
+*   \param  slot        The slot index
+*   \param  stats       Pointer to the structure to fill
+*   \return RETURN_OK or RETURN_NOK if the slot doesn't exist
+*/
+RET_TYPE perfGetCommandStats(uint8_t slot, perfCmdStats_t* stats)
+{
+    if (slot >= PERF_NB_CMD_SLOTS)
+    {
+        return RETURN_NOK;
+    }
+
+    memcpy((void*)stats, (void*)&perf_cmd_stats[slot], sizeof(*stats));
+    return RETURN_OK;
+}
+
+#endif
@@ -0,0 +1,99 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     perf_counters.h
+*    \brief    Optional performance counters
+*    Created:  19/10/2026
+*    Author:   agent
+*/
+
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// The bootloader never gets the instrumentation
+#if defined(MINI_BOOTLOADER)
+    #undef PERF_COUNTERS
+#endif
+
+// Counter IDs, reported in this order
+#define PERF_CNT_FLASH_READS        0
+#define PERF_CNT_FLASH_WRITES       1
+#define PERF_CNT_FLASH_ERASES       2
+#define PERF_CNT_FLASH_BYTES_READ   3
+#define PERF_CNT_FLASH_BYTES_WRITE  4
+#define PERF_CNT_AES_BLOCKS         5
+#define PERF_CNT_SPI_BYTES          6
+#define PERF_CNT_USB_REPORTS_IN     7
+#define PERF_CNT_USB_REPORTS_OUT    8
+#define PERF_CNT_FLASH_WAIT_US      9
+#define PERF_CNT_USB_WAIT_US        10
+#define PERF_CNT_DELAY_WAIT_US      11
+#define PERF_NB_COUNTERS            12
+
+// Number of USB commands for which service times are recorded, others go to the last slot
+#define PERF_NB_CMD_SLOTS           6
+#define PERF_CMD_SLOT_OTHER         0x00
+
+// Pages returned by CMD_GET_PERF_COUNTERS
+#define PERF_PAGE_COUNTERS          0
+#define PERF_PAGE_TASKS             1
+#define PERF_PAGE_COMMAND           2
+
+// Structs
+typedef struct
+{
+    uint16_t ms;
+    uint16_t sub_tick;
+} perfTimestamp_t;
+
+typedef struct
+{
+    uint8_t cmd;
+    uint16_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t total_us;
+} perfCmdStats_t;
+
+#ifdef PERF_COUNTERS
+    // Prototypes
+    void perfResetCounters(void);
+    void perfGetTimestamp(perfTimestamp_t* timestamp);
+    uint32_t perfGetElapsedUs(perfTimestamp_t* start);
+    void perfRecordCommand(uint8_t cmd, perfTimestamp_t* start);
+    RET_TYPE perfGetCommandStats(uint8_t slot, perfCmdStats_t* stats);
+
+    // Globals
+    extern uint32_t perf_counters[PERF_NB_COUNTERS];
+
+    // Macros
+    #define PERF_COUNT(id, value)           (perf_counters[(id)] += (value))
+    #define PERF_TIMESTAMP(ts)              perfTimestamp_t ts; perfGetTimestamp(&ts)
+    #define PERF_ADD_ELAPSED(id, ts)        (perf_counters[(id)] += perfGetElapsedUs(&ts))
+#else
+    #define PERF_COUNT(id, value)
+    #define PERF_TIMESTAMP(ts)
+    #define PERF_ADD_ELAPSED(id, ts)
+#endif
+
+#endif /* PERF_COUNTERS_H_ */
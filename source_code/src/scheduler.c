@@ -0,0 +1,161 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     scheduler.c
+*    \brief    Cooperative run-to-completion task scheduler
+*    Created:  19/10/2026
+*    Author:   agent
+*/
+#include "timer_manager.h"
+#include "scheduler.h"
+#include "defines.h"
+
+// Tasks array
+taskEntry_t scheduler_tasks[NUMBER_OF_TASKS];
+// Set while the nestable tasks are run from a blocking loop, to prevent recursion
+uint8_t scheduler_yield_run = FALSE;
+
+
+/*! \fn     schedulerRegisterTask(uint8_t task_id, taskFunction_t function, uint16_t period, uint16_t deadline, uint8_t flags)
+*   \brief  Register a task in the scheduler
+*   \param  task_id     Task ID, which is also its priority (0 is the highest)
+*   \param  function    Function to be called, it must run to completion
+*   \param  period      Minimum delay in ms between two calls, 0 to run at each pass
+*   \param  deadline    Maximum latency in ms before a call is counted as missed, 0 for none
+*   \param  flags       TASK_FLAG_NESTABLE if the task can be called from inside blocking delays
+*/
+void schedulerRegisterTask(uint8_t task_id, taskFunction_t function, uint16_t period, uint16_t deadline, uint8_t flags)
+{
+    taskEntry_t* task = &scheduler_tasks[task_id];
+
+    task->function = function;
+    task->period = period;
+    task->deadline = deadline;
+    task->last_run = getSystemTick();
+    task->max_latency = 0;
+    task->deadline_misses = 0;
+    task->flags = flags;
+}
+
+/*! \fn     schedulerRunTask(taskEntry_t* task, uint16_t current_tick)
+*   \brief  Run a given task if it is due, updating its statistics
+*   \param  task            Pointer to the task
+*   \param  current_tick    Current system tick
+*/
+static void schedulerRunTask(taskEntry_t* task, uint16_t current_tick)
+{
+    uint16_t elapsed = current_tick - task->last_run;
+
+    // Check that the task is registered and due
+    if ((task->function == 0) || (elapsed < task->period))
+    {
+        return;
+    }
+
+    // Latency is the time elapsed since the task was due
+    uint16_t latency = elapsed - task->period;
+    if (latency > task->max_latency)
+    {
+        task->max_latency = latency;
+    }
+    if ((task->deadline != 0) && (latency > task->deadline))
+    {
+        task->deadline_misses++;
+    }
+
+    // A running task is flagged so that a blocking loop inside it can't re-enter it
+    task->last_run = current_tick;
+    task->flags |= TASK_FLAG_RUNNING;
+    task->function();
+    task->flags &= ~TASK_FLAG_RUNNING;
+}
+
+/*! \fn     schedulerRunPendingTasks(void)
+*   \brief  Run all the tasks that are due, by decreasing priority
+*/
+void schedulerRunPendingTasks(void)
+{
+    for (uint8_t i = 0; i < NUMBER_OF_TASKS; i++)
+    {
+        schedulerRunTask(&scheduler_tasks[i], getSystemTick());
+    }
+}
+
+/*! \fn     schedulerYield(void)
+*   \brief  Run the nestable tasks that are due and not already running, called from blocking loops
+*/
+void schedulerYield(void)
+{
+    // Prevent recursion if a nestable task calls a blocking delay
+    if (scheduler_yield_run != FALSE)
+    {
+        return;
+    }
+
+    scheduler_yield_run = TRUE;
+    for (uint8_t i = 0; i < NUMBER_OF_TASKS; i++)
+    {
+        if ((scheduler_tasks[i].flags & (TASK_FLAG_NESTABLE|TASK_FLAG_RUNNING)) == TASK_FLAG_NESTABLE)
+        {
+            schedulerRunTask(&scheduler_tasks[i], getSystemTick());
+        }
+    }
+    scheduler_yield_run = FALSE;
+}
+
+/*! \fn     schedulerIsYieldRun(void)
+*   \brief  Know if the running task was called from a blocking loop
+*   \return TRUE if called through schedulerYield, FALSE otherwise
+*/
+uint8_t schedulerIsYieldRun(void)
+{
+    return scheduler_yield_run;
+}
+
+/*! \fn     schedulerGetTaskMaxLatency(uint8_t task_id)
+*   \brief  Get the maximum latency observed for a given task
+*   \param  task_id     Task ID
+*   \return The max latency in ms
+*/
+uint16_t schedulerGetTaskMaxLatency(uint8_t task_id)
+{
+    return scheduler_tasks[task_id].max_latency;
+}
+
+/*! \fn     schedulerGetTaskDeadlineMisses(uint8_t task_id)
+*   \brief  Get the number of times a given task missed its deadline
+*   \param  task_id     Task ID
+*   \return The number of deadline misses
+*/
+uint16_t schedulerGetTaskDeadlineMisses(uint8_t task_id)
+{
+    return scheduler_tasks[task_id].deadline_misses;
+}
+
+/*! \fn     schedulerResetTaskStatistics(void)
+*   \brief  Reset the latency statistics of all tasks
+*/
+void schedulerResetTaskStatistics(void)
+{
+    for (uint8_t i = 0; i < NUMBER_OF_TASKS; i++)
+    {
+        scheduler_tasks[i].max_latency = 0;
+        scheduler_tasks[i].deadline_misses = 0;
+    }
+}
@@ -0,0 +1,90 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     scheduler.h
+*    \brief    Cooperative run-to-completion task scheduler
+*    Created:  19/10/2026
+*    Author:   agent
+*/
+
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// Typedefs
+typedef void (*taskFunction_t)(void);
+
+// Structs
+typedef struct
+{
+    taskFunction_t function;
+    uint16_t period;
+    uint16_t deadline;
+    uint16_t last_run;
+    uint16_t max_latency;
+    uint16_t deadline_misses;
+    uint8_t flags;
+} taskEntry_t;
+
+// Prototypes
+void schedulerYield(void);
+uint8_t schedulerIsYieldRun(void);
+void schedulerRunPendingTasks(void);
+void schedulerResetTaskStatistics(void);
+uint16_t schedulerGetTaskMaxLatency(uint8_t task_id);
+uint16_t schedulerGetTaskDeadlineMisses(uint8_t task_id);
+void schedulerRegisterTask(uint8_t task_id, taskFunction_t function, uint16_t period, uint16_t deadline, uint8_t flags);
+
+// Task flags
+#define TASK_FLAG_NONE          0x00
+#define TASK_FLAG_NESTABLE      0x01
+#define TASK_FLAG_RUNNING       0x80
+
+// Tasks, by decreasing priority
+#if defined(LEDS_ENABLED_MINI)
+    #define NUMBER_OF_TASKS     5
+    #define TASK_USB            0
+    #define TASK_LEDS           1
+    #define TASK_INPUTS         2
+    #define TASK_GUI            3
+    #define TASK_LUT            4
+#else
+    #define NUMBER_OF_TASKS     4
+    #define TASK_USB            0
+    #define TASK_INPUTS         1
+    #define TASK_GUI            2
+    #define TASK_LUT            3
+#endif
+
+// Task periods & deadlines, in ms (0 for a task that runs at each pass / has no deadline)
+#define TASK_USB_PERIOD         0
+#define TASK_USB_DEADLINE       50
+#define TASK_LEDS_PERIOD        1
+#define TASK_LEDS_DEADLINE      20
+#define TASK_INPUTS_PERIOD      5
+#define TASK_INPUTS_DEADLINE    100
+#define TASK_GUI_PERIOD         0
+#define TASK_GUI_DEADLINE       0
+#define TASK_LUT_PERIOD         10
+#define TASK_LUT_DEADLINE       0
+
+#endif /* SCHEDULER_H_ */
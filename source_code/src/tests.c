@@ -202,7 +202,7 @@ void afterTouchInitTests(void)
             printf("counter: %04X\r\n", temp_uint++);
         }
         // Process possible incoming data
-        if(usbRawHidRecv(usb_buffer, USB_READ_TIMEOUT) == RETURN_COM_TRANSF_OK)
+        if(usbRawHidRecv(usb_buffer) == RETURN_COM_TRANSF_OK)
         {
             usbProcessIncoming(usb_buffer);
             activateProxDetection();
@@ -227,7 +227,7 @@ void afterTouchInitTests(void)
             printf("counter: %04X\r\n", temp_uint++);
         }
         // Process possible incoming data
-        if(usbRawHidRecv(usb_buffer, USB_READ_TIMEOUT) == RETURN_COM_TRANSF_OK)
+        if(usbRawHidRecv(usb_buffer) == RETURN_COM_TRANSF_OK)
         {
             usbProcessIncoming(usb_buffer);
         }
@@ -24,40 +24,131 @@
 */
 #include "timer_manager.h"
 #include <util/atomic.h>
+#include "perf_counters.h"
+#include "scheduler.h"
 #include "defines.h"
 
 // Timers array
 volatile timerEntry_t context_timers[TOTAL_NUMBER_OF_TIMERS];
-volatile uint16_t timer_divider;
+// Remaining full periods for the slow timers
+volatile uint16_t slow_timer_rounds[NUMBER_OF_SLOW_TIMERS];
+// Callbacks called when the timers expire
+volatile timerCallback_t timer_callbacks[TOTAL_NUMBER_OF_TIMERS];
+// First timer to expire in the delta list
+volatile uint8_t timer_list_head = TIMER_LIST_END;
+// Free running ms tick
+volatile uint16_t timer_tick;
 
 
+/*!	\fn		timerListInsert(uint8_t uid, uint16_t val)
+*	\brief	Insert a timer in the delta list, interrupts must be disabled
+*   \param  uid Unique ID
+*   \param  val Delay, not null
+*/
+static void timerListInsert(uint8_t uid, uint16_t val)
+{
+    volatile uint8_t* prev_next = &timer_list_head;
+    uint8_t cur = timer_list_head;
+
+    // Find the first timer expiring after this one, each entry stores its delay relative to the previous one
+    while ((cur != TIMER_LIST_END) && (context_timers[cur].delta <= val))
+    {
+        val -= context_timers[cur].delta;
+        prev_next = &context_timers[cur].next;
+        cur = *prev_next;
+    }
+
+    // Link our timer and update the delay of the next one
+    context_timers[uid].delta = val;
+    context_timers[uid].next = cur;
+    context_timers[uid].flag = TIMER_QUEUED;
+    *prev_next = uid;
+    if (cur != TIMER_LIST_END)
+    {
+        context_timers[cur].delta -= val;
+    }
+}
+
+/*!	\fn		timerListRemove(uint8_t uid)
+*	\brief	Remove a queued timer from the delta list, interrupts must be disabled
+*   \param  uid Unique ID
+*/
+static void timerListRemove(uint8_t uid)
+{
+    volatile uint8_t* prev_next = &timer_list_head;
+    uint8_t next = context_timers[uid].next;
+
+    while (*prev_next != uid)
+    {
+        prev_next = &context_timers[*prev_next].next;
+    }
+
+    // Give our remaining delay to the next timer
+    *prev_next = next;
+    if (next != TIMER_LIST_END)
+    {
+        context_timers[next].delta += context_timers[uid].delta;
+    }
+}
+
 /*!	\fn		timerManagerTick(void)
 *	\brief	Function called by interrupt every ms
 */
 void timerManagerTick(void)
 {
-    uint8_t i;
-    
-    // Increment divider
-    timer_divider++;
-    
-    // Loop through the timers
-    for (i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    timerCallback_t callback;
+    uint8_t uid;
+
+    // Increment free running tick
+    timer_tick++;
+
+    // Only the head of the delta list needs to be decremented
+    if (timer_list_head == TIMER_LIST_END)
+    {
+        return;
+    }
+    context_timers[timer_list_head].delta--;
+
+    // Pop all the timers expiring at this tick
+    while ((timer_list_head != TIMER_LIST_END) && (context_timers[timer_list_head].delta == 0))
     {
-        // If it's a fast timer or if it not & timer_divider rolled over
-        if ((i < NUMBER_OF_FAST_TIMERS) || (timer_divider == 0))
+        uid = timer_list_head;
+        timer_list_head = context_timers[uid].next;
+
+        if ((uid >= NUMBER_OF_FAST_TIMERS) && (slow_timer_rounds[uid - NUMBER_OF_FAST_TIMERS] != 0))
+        {
+            // Slow timer with full periods left
+            slow_timer_rounds[uid - NUMBER_OF_FAST_TIMERS]--;
+            timerListInsert(uid, SLOW_TIMER_PERIOD);
+        }
+        else
         {
-            if (context_timers[i].timer_val != 0)
+            context_timers[uid].flag = TIMER_EXPIRED;
+            callback = timer_callbacks[uid];
+            if (callback != 0)
             {
-                if (context_timers[i].timer_val-- == 1)
-                {
-                    context_timers[i].flag = TIMER_EXPIRED;
-                }
+                callback();
             }
         }
     }
 }
 
+/*!	\fn		getSystemTick(void)
+*	\brief	Get the free running ms tick, incremented by timerManagerTick
+*   \return the current tick value
+*/
+uint16_t getSystemTick(void)
+{
+    uint16_t tick;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        tick = timer_tick;
+    }
+
+    return tick;
+}
+
 /*!	\fn		hasTimerExpired(uint8_t uid)
 *	\brief	Know if a timer expired and clear the flag if so
 *   \param  uid     Unique ID
@@ -84,37 +175,82 @@ RET_TYPE hasTimerExpired(uint8_t uid, uint8_t clear)
 /*!	\fn		activateTimer(uint8_t uid, uint16_t val)
 *	\brief	Activate timer
 *   \param  uid Unique ID
-*   \param  val Delay
+*   \param  val Delay, in ms for fast timers or in SLOW_TIMER_PERIOD units for slow timers
 */
 void activateTimer(uint8_t uid, uint16_t val)
 {
-    // Compare is done in one cycle
-    if (context_timers[uid].timer_val != val)
+    // Nothing to do if the timer already has that value (slow timers are always re-armed)
+    if (((uid < NUMBER_OF_FAST_TIMERS) || (val == 0)) && (getTimerVal(uid) == val))
     {
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (context_timers[uid].flag == TIMER_QUEUED)
         {
-            context_timers[uid].timer_val = val;
-            if (val == 0)
-            {
-                context_timers[uid].flag = TIMER_EXPIRED;
-            } 
-            else
-            {
-                context_timers[uid].flag = TIMER_RUNNING;
-            }
+            timerListRemove(uid);
+        }
+
+        if (val == 0)
+        {
+            context_timers[uid].flag = TIMER_EXPIRED;
+        }
+        else if (uid >= NUMBER_OF_FAST_TIMERS)
+        {
+            slow_timer_rounds[uid - NUMBER_OF_FAST_TIMERS] = val - 1;
+            timerListInsert(uid, SLOW_TIMER_PERIOD);
+        }
+        else
+        {
+            timerListInsert(uid, val);
         }
     }
 }
 
+/*!	\fn		registerTimerCallback(uint8_t uid, timerCallback_t callback)
+*	\brief	Set a function to be called when a timer expires
+*   \param  uid         Unique ID
+*   \param  callback    Function to call, 0 to remove it
+*   \note   The callback is called from the 1ms interrupt and must be kept short
+*/
+void registerTimerCallback(uint8_t uid, timerCallback_t callback)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        timer_callbacks[uid] = callback;
+    }
+}
 
 /*!	\fn		getTimerVal(uint8_t uid)
 *	\brief	Get current timer val
 *   \param  uid     Unique ID
-*   \return the timer val
+*   \return the timer val, in ms (for slow timers: until the end of the current period)
 */
 uint16_t getTimerVal(uint8_t uid)
 {
-    return context_timers[uid].timer_val;
+    uint16_t val = 0;
+    uint8_t cur;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (context_timers[uid].flag == TIMER_QUEUED)
+        {
+            // Sum the delays up to our timer
+            cur = timer_list_head;
+            while (1)
+            {
+                val += context_timers[cur].delta;
+                if (cur == uid)
+                {
+                    break;
+                }
+                cur = context_timers[cur].next;
+            }
+        }
+    }
+
+    return val;
 }
 
 /*!	\fn		timerBasedDelayMs(uint16_t ms)
@@ -123,8 +259,14 @@ uint16_t getTimerVal(uint8_t uid)
 */
 void timerBasedDelayMs(uint16_t ms)
 {
+    PERF_TIMESTAMP(wait_start);
     activateTimer(TIMER_WAIT_FUNCTS, ms+1);
-    while(hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) != TIMER_EXPIRED);
+    while(hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) != TIMER_EXPIRED)
+    {
+        // Let the background tasks run while we wait
+        schedulerYield();
+    }
+    PERF_ADD_ELAPSED(PERF_CNT_DELAY_WAIT_US, wait_start);
 }
 
 /*!	\fn		timerBased130MsDelay(void)
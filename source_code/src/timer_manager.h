@@ -30,19 +30,25 @@
 #include "defines.h"
 #include <stdint.h>
 
+// Typedefs
+typedef void (*timerCallback_t)(void);
+
 // Prototypes
 void timerManagerTick(void);
 void timerBased130MsDelay(void);
 void timerBased500MsDelay(void);
 uint16_t getTimerVal(uint8_t uid);
+uint16_t getSystemTick(void);
 void timerBasedDelayMs(uint16_t ms);
 void activateTimer(uint8_t uid, uint16_t val);
 RET_TYPE hasTimerExpired(uint8_t uid, uint8_t clear);
+void registerTimerCallback(uint8_t uid, timerCallback_t callback);
 
 // Structs
 typedef struct
 {
-    uint16_t timer_val;
+    uint16_t delta;
+    uint8_t next;
     uint8_t flag;
 } timerEntry_t;
 
@@ -79,5 +85,8 @@ typedef struct
 #endif
 
 #define TOTAL_NUMBER_OF_TIMERS  (NUMBER_OF_FAST_TIMERS+NUMBER_OF_SLOW_TIMERS)
+#define SLOW_TIMER_PERIOD       65535
+#define TIMER_LIST_END          0xFF
+#define TIMER_QUEUED            2       // Timer flag value while in the delta list, seen as TIMER_RUNNING
 
 #endif /* TIMER_MANAGER_H_ */
\ No newline at end of file
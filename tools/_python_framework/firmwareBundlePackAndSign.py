@@ -38,10 +38,13 @@ def bundlePackAndSign(bundleName, firmwareName, oldAesKey, newAesKey, updateFile
 	AES_KEY_LENGTH = 256/8								# AES key length (256 bits)
 	FW_VERSION_LENGTH = 4								# Length of the firmware version in the bundle
 	AES_KEY_UPDATE_FLAG_LGTH = 1						# Length of the tag which specifies a firmware udpate
+	SEGMENTED_MAGIC = "MPSEGMAC"						# Tag telling the bootloader that a firmware segment CBCMAC is present
+	SEGMENTED_MAGIC_LENGTH = len(SEGMENTED_MAGIC)		# Length of the tag which specifies a segmented bundle
 	FW_MAX_LENGTH = 28672								# Maximum firmware length, depends on size allocated to bootloader
 	FLASH_SECTOR_0_LENGTH = 264*8						# Length in bytes of sector 0a in external flash (to change for 16Mb & 32Mb flash!)
 	STORAGE_SPACE = 65536 - FLASH_SECTOR_0_LENGTH		# Uint16_t addressing space - sector 0a length (dedicated to other storage...)
-	BUNDLE_MAX_LENGTH = STORAGE_SPACE - FW_MAX_LENGTH - HASH_LENGH - AES_KEY_LENGTH - FW_VERSION_LENGTH - AES_KEY_UPDATE_FLAG_LGTH
+	VERSION_BLOCK_LENGTH = 16							# Length of the block preceding the firmware: padding | segmented magic | firmware version | new aes key bool
+	BUNDLE_MAX_LENGTH = STORAGE_SPACE - FW_MAX_LENGTH - HASH_LENGH - AES_KEY_LENGTH - VERSION_BLOCK_LENGTH - HASH_LENGH
 	
 	# Robust RNG
 	rng = Random.new()
@@ -98,7 +101,7 @@ def bundlePackAndSign(bundleName, firmwareName, oldAesKey, newAesKey, updateFile
 		print "Remaining space in MCU flash:", FW_MAX_LENGTH - len(firmware), "bytes"
 	
 	if verbose == True:
-		print "Remaining space in bundle:", STORAGE_SPACE - FW_MAX_LENGTH - HASH_LENGH - AES_KEY_LENGTH - FW_VERSION_LENGTH - AES_KEY_UPDATE_FLAG_LGTH - len(bundle), "bytes"
+		print "Remaining space in bundle:", BUNDLE_MAX_LENGTH - len(bundle), "bytes"
 		
 	# Beta testers devices have their aes key set to 00000... and the bootloader will always perform a key update
 	if oldAesKey == "0000000000000000000000000000000000000000000000000000000000000000" and newAesKey == None:
@@ -154,10 +157,15 @@ def bundlePackAndSign(bundleName, firmwareName, oldAesKey, newAesKey, updateFile
 	else:
 		enc_password = [255]*AES_KEY_LENGTH
 		
-	# Generate beginning of update file data: bundle | padding | firmware version | new aes key bool | firmware | padding | new aes key encoded
+	# Generate beginning of update file data: bundle | padding | firmware cbcmac | padding | segmented magic | firmware version | new aes key bool | firmware | padding | new aes key encoded
 	update_file_data = array('B')
 	update_file_data.extend(bytearray(bundle))
-	update_file_data.extend(array('B',[0]*(STORAGE_SPACE-HASH_LENGH-AES_KEY_LENGTH-FW_MAX_LENGTH-FW_VERSION_LENGTH-AES_KEY_UPDATE_FLAG_LGTH-len(bundle))))
+	update_file_data.extend(array('B',[0]*(BUNDLE_MAX_LENGTH-len(bundle))))
+	firmware_cbc_mac_index = len(update_file_data)
+	update_file_data.extend(array('B',[0]*HASH_LENGH))
+	version_block_index = len(update_file_data)
+	update_file_data.extend(array('B',[0]*(VERSION_BLOCK_LENGTH-SEGMENTED_MAGIC_LENGTH-FW_VERSION_LENGTH-AES_KEY_UPDATE_FLAG_LGTH)))
+	update_file_data.extend(array('B', SEGMENTED_MAGIC))
 	update_file_data.extend(firmware_version)
 	if aes_key_update_bool == True:
 		update_file_data.append(255)
@@ -172,6 +180,12 @@ def bundlePackAndSign(bundleName, firmwareName, oldAesKey, newAesKey, updateFile
 		print "Problem with update file length!"
 		return False
 		
+	# Generate the firmware segment CBCMAC over the version block and the firmware, IV is ZEROS
+	# The bootloader checks it when programming, after having checked the whole bundle CBCMAC
+	cipher = AES.new(old_aes_key, AES.MODE_CBC, array('B',[0]*AES.block_size))
+	firmware_cbc_mac = cipher.encrypt(update_file_data[version_block_index:version_block_index+VERSION_BLOCK_LENGTH+FW_MAX_LENGTH])[-AES.block_size:]
+	update_file_data[firmware_cbc_mac_index:firmware_cbc_mac_index+HASH_LENGH] = array('B', bytearray(firmware_cbc_mac))
+		
 	# Generate CBCMAC, IV is ZEROS
 	cipher = AES.new(old_aes_key, AES.MODE_CBC, array('B',[0]*AES.block_size))
 	cbc_mac = cipher.encrypt(update_file_data)[-AES.block_size:]
@@ -0,0 +1,205 @@
+#!/usr/bin/env python2
+#
+# Copyright (c) 2026 agent
+# All rights reserved.
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at src/license_cddl-1.0.txt
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at src/license_cddl-1.0.txt
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# HID latency & throughput benchmark.
+# A fixed mix of commands with fixed payloads is sent N times, each command waiting for its answer.
+# For meaningful results a user should be logged in with the benchmark context stored
+# (otherwise the device answers errors, which are still timed), and the memory management
+# mode request must be approved on the device.
+from mooltipass_hid_device import *
+from mooltipass_defines import *
+from datetime import datetime
+from array import array
+import platform
+import struct
+import json
+import math
+import time
+
+# Fixed benchmark payloads
+BENCHMARK_CONTEXT       = "benchmark.mooltipass.com"
+BENCHMARK_NODE_ADDR     = 0x0800						# First node address after the graphics zone
+BENCHMARK_ITERATIONS    = 100
+
+# Performance counters names, in the order sent by the device
+PERF_COUNTERS_NAMES     = ["flash_reads", "flash_writes", "flash_erases", "flash_bytes_read", "flash_bytes_written", "aes_blocks", "spi_bytes", "usb_reports_in", "usb_reports_out", "flash_wait_us", "usb_wait_us", "delay_wait_us"]
+PERF_PAGE_COUNTERS      = 0
+PERF_PAGE_TASKS         = 1
+PERF_PAGE_COMMAND       = 2
+PERF_NB_CMD_SLOTS       = 6
+
+# Get the benchmark command mix: [name, packet, needs memory management mode, number of answer packets on success]
+def benchmarkGetCommandMix(mooltipass_device):
+	return [
+		["CMD_CONTEXT", mooltipass_device.getPacketForCommand(CMD_CONTEXT, len(BENCHMARK_CONTEXT)+1, mooltipass_device.textToByteArray(BENCHMARK_CONTEXT)), False, 1],
+		["CMD_GET_LOGIN", mooltipass_device.getPacketForCommand(CMD_GET_LOGIN, 0, None), False, 1],
+		["CMD_READ_32B_IN_DN", mooltipass_device.getPacketForCommand(CMD_READ_32B_IN_DN, 0, None), False, 1],
+		["CMD_GET_RANDOM_NUMBER", mooltipass_device.getPacketForCommand(CMD_GET_RANDOM_NUMBER, 0, None), False, 1],
+		["CMD_READ_FLASH_NODE", mooltipass_device.getPacketForCommand(CMD_READ_FLASH_NODE, 2, array('B', struct.pack('<H', BENCHMARK_NODE_ADDR))), True, (NODE_SIZE+61)/62],
+		["CMD_GET_FREE_SLOTS_ADDR", mooltipass_device.getPacketForCommand(CMD_GET_30_FREE_SLOTS, 2, array('B', struct.pack('<H', BENCHMARK_NODE_ADDR))), True, 1]]
+
+# Check if an answer packet is a one byte error answer
+def benchmarkIsErrorAnswer(answer):
+	return answer[LEN_INDEX] == 1 and answer[DATA_INDEX] == 0
+
+# Nearest rank percentile of a sorted list
+def benchmarkPercentile(sorted_values, percentile):
+	if len(sorted_values) == 0:
+		return None
+	rank = int(math.ceil(percentile / 100.0 * len(sorted_values))) - 1
+	return sorted_values[max(0, min(rank, len(sorted_values) - 1))]
+
+# Send a packet and time until its full answer arrives, returns [latency in s, first answer packet, number of answer packets]
+def benchmarkTimeCommand(mooltipass_device, packet, nb_answers):
+	start = time.time()
+	mooltipass_device.getInternalDevice().sendHidPacket(packet)
+	answer = mooltipass_device.getInternalDevice().receiveHidPacket()
+	nb_received = 1
+	if not benchmarkIsErrorAnswer(answer):
+		while nb_received < nb_answers:
+			mooltipass_device.getInternalDevice().receiveHidPacket()
+			nb_received += 1
+	return [time.time() - start, answer, nb_received]
+
+# Compute the statistics of a list of latencies
+def benchmarkGetStats(latencies, nb_bytes, nb_errors):
+	sorted_latencies = sorted(latencies)
+	total_time = sum(latencies)
+	stats = {}
+	stats["count"] = len(latencies)
+	stats["errors"] = nb_errors
+	stats["min_ms"] = sorted_latencies[0] * 1000
+	stats["max_ms"] = sorted_latencies[-1] * 1000
+	stats["mean_ms"] = total_time * 1000 / len(latencies)
+	for percentile in [50, 90, 95, 99]:
+		stats["p" + str(percentile) + "_ms"] = benchmarkPercentile(sorted_latencies, percentile) * 1000
+	stats["commands_per_s"] = len(latencies) / total_time
+	stats["bytes_per_s"] = nb_bytes / total_time
+	return stats
+
+# Fetch the on-device performance counters, only supported by firmwares built with PERF_COUNTERS
+def benchmarkGetPerfCounters(mooltipass_device):
+	perf = {}
+	device = mooltipass_device.getInternalDevice()
+	
+	device.sendHidPacket([1, CMD_GET_PERF_COUNTERS, PERF_PAGE_COUNTERS])
+	data = device.receiveHidPacketWithTimeout()
+	if data == None or data[LEN_INDEX] != 4*len(PERF_COUNTERS_NAMES):
+		print "Device doesn't support performance counters"
+		return None
+	values = struct.unpack('<' + 'I'*len(PERF_COUNTERS_NAMES), data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]].tostring())
+	perf["counters"] = dict(zip(PERF_COUNTERS_NAMES, values))
+	
+	# Scheduler tasks: max latency & deadline misses
+	device.sendHidPacket([1, CMD_GET_PERF_COUNTERS, PERF_PAGE_TASKS])
+	data = device.receiveHidPacket()
+	values = struct.unpack('<' + 'H'*(data[LEN_INDEX]/2), data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]].tostring())
+	perf["tasks"] = [{"max_latency_ms": values[i], "deadline_misses": values[i+1]} for i in range(0, len(values), 2)]
+	
+	# Command service times: cmd, count, min / max / total us
+	perf["commands"] = []
+	for slot in range(0, PERF_NB_CMD_SLOTS):
+		device.sendHidPacket([2, CMD_GET_PERF_COUNTERS, PERF_PAGE_COMMAND, slot])
+		data = device.receiveHidPacket()
+		cmd, count, min_us, max_us, total_us = struct.unpack('<BHIII', data[DATA_INDEX:DATA_INDEX+15].tostring())
+		if count != 0:
+			perf["commands"].append({"cmd": cmd, "count": count, "min_us": min_us, "max_us": max_us, "avg_us": total_us / count})
+	return perf
+
+# Run the benchmark and write the results to a json file
+def mooltipassBenchmark(mooltipass_device, iterations, output_filename, fetch_perf_counters):
+	device = mooltipass_device.getInternalDevice()
+	command_mix = benchmarkGetCommandMix(mooltipass_device)
+	latencies = {}
+	nb_errors = {}
+	nb_bytes = {}
+	for command in command_mix:
+		latencies[command[0]] = []
+		nb_errors[command[0]] = 0
+		nb_bytes[command[0]] = 0
+		
+	# Reset the on-device counters
+	if fetch_perf_counters == True:
+		device.sendHidPacket([0, CMD_RESET_PERF_COUNTERS])
+		if device.receiveHidPacketWithTimeout() == None:
+			print "Device doesn't support performance counters"
+			fetch_perf_counters = False
+		
+	# Ask for memory management mode if needed
+	if True in [command[2] for command in command_mix]:
+		print "Please approve memory management mode on the device"
+		device.sendHidPacket([0, CMD_START_MEMORYMGMT])
+		if device.receiveHidPacket()[DATA_INDEX] == 0:
+			print "Memory management mode refused, skipping the commands requiring it"
+			command_mix = [command for command in command_mix if command[2] == False]
+			
+	# Run the command mix
+	print "Running", iterations, "iterations of", len(command_mix), "commands"
+	benchmark_start = time.time()
+	for i in range(0, iterations):
+		for command in command_mix:
+			[latency, answer, nb_received] = benchmarkTimeCommand(mooltipass_device, command[1], command[3])
+			latencies[command[0]].append(latency)
+			# One packet out and the answer packets in
+			nb_bytes[command[0]] += 64 * (1 + nb_received)
+			if benchmarkIsErrorAnswer(answer):
+				nb_errors[command[0]] += 1
+	benchmark_time = time.time() - benchmark_start
+	
+	# Leave memory management mode
+	if True in [command[2] for command in command_mix]:
+		device.sendHidPacket([0, CMD_END_MEMORYMGMT])
+		device.receiveHidPacket()
+		
+	# Generate results
+	version_data = mooltipass_device.getMooltipassVersionAndVariant()
+	results = {}
+	results["date"] = datetime.now().isoformat()
+	results["host"] = platform.platform()
+	results["firmware_version"] = version_data[1]
+	results["firmware_variant"] = version_data[2]
+	results["flash_mb"] = version_data[0]
+	results["iterations"] = iterations
+	results["total_time_s"] = benchmark_time
+	results["commands"] = {}
+	for command in command_mix:
+		results["commands"][command[0]] = benchmarkGetStats(latencies[command[0]], nb_bytes[command[0]], nb_errors[command[0]])
+	if fetch_perf_counters == True:
+		results["device_perf_counters"] = benchmarkGetPerfCounters(mooltipass_device)
+		
+	# Print summary
+	print ""
+	print "%-24s %8s %8s %8s %8s %8s %10s %7s" % ("Command", "p50 ms", "p90 ms", "p99 ms", "max ms", "mean ms", "cmd/s", "errors")
+	for command in command_mix:
+		stats = results["commands"][command[0]]
+		print "%-24s %8.2f %8.2f %8.2f %8.2f %8.2f %10.1f %7d" % (command[0], stats["p50_ms"], stats["p90_ms"], stats["p99_ms"], stats["max_ms"], stats["mean_ms"], stats["commands_per_s"], stats["errors"])
+	print ""
+	print "Overall:", iterations*len(command_mix) / benchmark_time, "commands/s"
+	
+	# Write machine readable results
+	fd = open(output_filename, 'w')
+	json.dump(results, fd, indent=4, sort_keys=True)
+	fd.close()
+	print "Results written to", output_filename
+	return results
@@ -0,0 +1,235 @@
+#!/usr/bin/env python2
+#
+# Copyright (c) 2026 agent
+# All rights reserved.
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at src/license_cddl-1.0.txt
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at src/license_cddl-1.0.txt
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Sorted bulk load of a user backup into an empty user.
+# Services and logins are sorted on the host and the nodes are laid out in list order in runs of
+# contiguous free slots, each parent followed by its children, with all the links computed
+# beforehand. Walking the lists on the device then goes through consecutive pages, and the device
+# doesn't reload a page from flash between the nodes written in a row to it.
+# The backup is the container written by the python_comms user export (see mooltipass_backup.py there).
+from mooltipass_hid_device import *
+from mooltipass_defines import *
+from array import array
+import struct
+import sys
+import os
+
+# Backup container, shared with the python_comms user export
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_comms"))
+from mooltipass_backup import *
+
+# Node layout
+NODE_START_ADDRESS              = 0x0800						# First node address after the graphics zone
+NODE_ADDR_SHMT                  = 3
+NODE_TYPE_PARENT                = 0
+NODE_SIZE_OF_SERVICE            = 58
+NODE_SIZE_OF_LOGIN              = 63
+NODE_WRITE_CHUNK_SIZE           = 59
+BULK_LOAD_PIPELINE_DEPTH        = 2
+
+# Read a backup, returns [nodes by address, favorites, starting parent, CPZ/CTR payloads, CTR payload] or None
+def bulkLoadReadBackup(filename):
+	nodes = {}
+	favorites = []
+	starting_parent = 0
+	cpz_ctr = []
+	ctr = None
+	try:
+		for [record_type, payload] in backupRecords(filename):
+			if record_type == BACKUP_RECORD_FAVORITE:
+				favorites.append(list(struct.unpack('<BHH', payload)))
+			elif record_type == BACKUP_RECORD_STARTING_PARENT:
+				starting_parent = struct.unpack('<H', payload)[0]
+			elif record_type == BACKUP_RECORD_NODE:
+				nodes[struct.unpack('<H', payload[0:2])[0]] = array('B', payload[2:])
+			elif record_type == BACKUP_RECORD_CPZ_CTR:
+				cpz_ctr.append(payload)
+			elif record_type == BACKUP_RECORD_CTR:
+				ctr = payload
+	except (IOError, ValueError) as e:
+		print e
+		return None
+	return [nodes, favorites, starting_parent, cpz_ctr, ctr]
+
+# Node fields helpers
+def bulkLoadGetNodeType(node):
+	# node type is in the 2 MSBs of the flags (LSB first)
+	return node[1] >> 6
+
+def bulkLoadGetAddressField(node, index):
+	return node[index] + (node[index+1] << 8)
+
+def bulkLoadSetAddressField(node, index, address):
+	node[index] = address & 0xFF
+	node[index+1] = address >> 8
+
+def bulkLoadGetTextField(node, index, size):
+	# same ordering as the device strncmp
+	return node[index:index+size].tostring().split("\x00")[0]
+
+# Sort the credentials: returns a list of [parent node, sorted child nodes] sorted by service, with the old addresses
+def bulkLoadSortCredentials(nodes):
+	credentials = []
+	for address in nodes:
+		if bulkLoadGetNodeType(nodes[address]) == NODE_TYPE_PARENT:
+			children = []
+			child_address = bulkLoadGetAddressField(nodes[address], NEXT_CHILD_INDEX)
+			while child_address != 0 and child_address in nodes and len(children) < len(nodes):
+				children.append(child_address)
+				child_address = bulkLoadGetAddressField(nodes[child_address], NEXT_ADDRESS_INDEX)
+			children.sort(key=lambda child: bulkLoadGetTextField(nodes[child], LOGIN_INDEX, NODE_SIZE_OF_LOGIN))
+			credentials.append([address, children])
+	credentials.sort(key=lambda credential: bulkLoadGetTextField(nodes[credential[0]], SERVICE_INDEX, NODE_SIZE_OF_SERVICE))
+	return credentials
+
+# Get the address of the slot following a given one
+def bulkLoadNextSlot(address, nodes_per_page):
+	if (address & ((1 << NODE_ADDR_SHMT) - 1)) + 1 < nodes_per_page:
+		return address + 1
+	return ((address >> NODE_ADDR_SHMT) + 1) << NODE_ADDR_SHMT
+
+# Ask the device for a run of contiguous free slots, returns its first address or 0
+def bulkLoadGetFreeRun(device, start_address, nb_slots):
+	device.sendHidPacket(array('B', [4, CMD_GET_FREE_NODE_RUN]) + array('B', struct.pack('<HH', start_address, nb_slots)))
+	data = device.receiveHidPacket()
+	if data[LEN_INDEX] != 2:
+		return 0
+	return data[DATA_INDEX] + (data[DATA_INDEX+1] << 8)
+
+# Allocate the new addresses in list order: a single run if possible, otherwise one run per parent and its children
+def bulkLoadAllocate(device, credentials, nodes_per_page):
+	address_map = {0: 0}
+	nb_nodes = sum(1 + len(children) for [parent, children] in credentials)
+	address = bulkLoadGetFreeRun(device, NODE_START_ADDRESS, nb_nodes)
+	single_run = address != 0
+	if not single_run:
+		print "No run of", nb_nodes, "free slots, laying out each parent with its children"
+	for [parent, children] in credentials:
+		if not single_run:
+			address = bulkLoadGetFreeRun(device, address if address != 0 else NODE_START_ADDRESS, 1 + len(children))
+			if address == 0:
+				print "Not enough contiguous free slots"
+				return None
+		for old_address in [parent] + children:
+			address_map[old_address] = address
+			address = bulkLoadNextSlot(address, nodes_per_page)
+	return address_map
+
+# Build the nodes to write with their new links, returns a list of [new address, node] in address order
+def bulkLoadLinkNodes(nodes, credentials, address_map):
+	new_nodes = []
+	for i in range(0, len(credentials)):
+		[parent, children] = credentials[i]
+		node = array('B', nodes[parent])
+		bulkLoadSetAddressField(node, PREV_ADDRESS_INDEX, address_map[credentials[i-1][0]] if i > 0 else 0)
+		bulkLoadSetAddressField(node, NEXT_ADDRESS_INDEX, address_map[credentials[i+1][0]] if i+1 < len(credentials) else 0)
+		bulkLoadSetAddressField(node, NEXT_CHILD_INDEX, address_map[children[0]] if len(children) > 0 else 0)
+		new_nodes.append([address_map[parent], node])
+		for j in range(0, len(children)):
+			node = array('B', nodes[children[j]])
+			bulkLoadSetAddressField(node, PREV_ADDRESS_INDEX, address_map[children[j-1]] if j > 0 else 0)
+			bulkLoadSetAddressField(node, NEXT_ADDRESS_INDEX, address_map[children[j+1]] if j+1 < len(children) else 0)
+			new_nodes.append([address_map[children[j]], node])
+	new_nodes.sort(key=lambda new_node: new_node[0])
+	return new_nodes
+
+# Send a packet without waiting for its answer, up to BULK_LOAD_PIPELINE_DEPTH packets in flight
+def bulkLoadSendPipelined(device, load_state, packet):
+	if load_state["in_flight"] == BULK_LOAD_PIPELINE_DEPTH:
+		bulkLoadReceiveAnswer(device, load_state)
+	device.sendHidPacket(packet)
+	load_state["in_flight"] += 1
+
+def bulkLoadReceiveAnswer(device, load_state):
+	data = device.receiveHidPacket()
+	load_state["in_flight"] -= 1
+	if data[DATA_INDEX] != 1:
+		load_state["errors"] += 1
+
+def bulkLoadFlush(device, load_state):
+	while load_state["in_flight"] != 0:
+		bulkLoadReceiveAnswer(device, load_state)
+
+# Load a backup into the current (empty) user
+def mooltipassBulkLoad(mooltipass_device, filename):
+	device = mooltipass_device.getInternalDevice()
+	backup = bulkLoadReadBackup(filename)
+	if backup is None:
+		return
+	[nodes, favorites, starting_parent, cpz_ctr, ctr] = backup
+	nodes_per_page = 2 if mooltipass_device.getMooltipassVersionAndVariant()[0] <= 8 else 4
+	credentials = bulkLoadSortCredentials(nodes)
+
+	# Go to MMM
+	device.sendHidPacket([0, CMD_START_MEMORYMGMT])
+	print "Please accept memory management mode on the device"
+	if device.receiveHidPacket()[DATA_INDEX] == 0:
+		print "Couldn't go to MMM!"
+		return
+
+	# Only load in an empty user profile, not to lose the current nodes
+	device.sendHidPacket([0, CMD_GET_STARTING_PARENT])
+	data = device.receiveHidPacket()
+	address_map = None
+	if data[LEN_INDEX] != 2 or data[DATA_INDEX] != 0 or data[DATA_INDEX+1] != 0:
+		print "Current user isn't empty"
+	else:
+		address_map = bulkLoadAllocate(device, credentials, nodes_per_page)
+
+	if address_map is not None:
+		load_state = {"in_flight": 0, "errors": 0}
+
+		# Nodes are written in address order, each in 59 bytes chunks: address, chunk number, data
+		new_nodes = bulkLoadLinkNodes(nodes, credentials, address_map)
+		for [address, node] in new_nodes:
+			for chunk in range(0, (NODE_SIZE + NODE_WRITE_CHUNK_SIZE - 1) / NODE_WRITE_CHUNK_SIZE):
+				payload = array('B', struct.pack('<HB', address, chunk)) + node[chunk*NODE_WRITE_CHUNK_SIZE:(chunk+1)*NODE_WRITE_CHUNK_SIZE]
+				bulkLoadSendPipelined(device, load_state, mooltipass_device.getPacketForCommand(CMD_WRITE_FLASH_NODE, len(payload), payload))
+
+		# Starting parent & favorites pointing to the loaded nodes
+		if len(credentials) > 0:
+			bulkLoadSendPipelined(device, load_state, mooltipass_device.getPacketForCommand(CMD_SET_STARTING_PARENT, 2, array('B', struct.pack('<H', address_map[credentials[0][0]]))))
+		for [fav_id, parent_addr, child_addr] in favorites:
+			if parent_addr in address_map and child_addr in address_map:
+				bulkLoadSendPipelined(device, load_state, mooltipass_device.getPacketForCommand(CMD_SET_FAVORITE, 5, array('B', struct.pack('<BHH', fav_id, address_map[parent_addr], address_map[child_addr]))))
+		bulkLoadFlush(device, load_state)
+
+		# CPZ/CTR entries, already known entries are refused
+		for payload in cpz_ctr:
+			device.sendHidPacket(mooltipass_device.getPacketForCommand(CMD_ADD_CARD_CPZ_CTR, len(payload), array('B', payload)))
+			device.receiveHidPacket()
+
+		# Never set the CTR back, as CTR values must not be reused
+		if ctr is not None:
+			device.sendHidPacket([0, CMD_GET_CTRVALUE])
+			data = device.receiveHidPacket()
+			if array('B', ctr).tolist() > data[DATA_INDEX:DATA_INDEX+len(ctr)].tolist():
+				device.sendHidPacket(mooltipass_device.getPacketForCommand(CMD_SET_CTRVALUE, len(ctr), array('B', ctr)))
+				device.receiveHidPacket()
+
+		print len(new_nodes), "nodes loaded for", len(credentials), "services,", load_state["errors"], "packets refused"
+
+	# Leave MMM
+	device.sendHidPacket([0, CMD_END_MEMORYMGMT])
+	device.receiveHidPacket()
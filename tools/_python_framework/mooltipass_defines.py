@@ -47,6 +47,8 @@ NODE_SIZE				= 132
 DEVICE_PASSWORD_SIZE	= 62
 
 # Command IDs
+CMD_GET_PERF_COUNTERS   = 0x88
+CMD_RESET_PERF_COUNTERS = 0x89
 CMD_EXPORT_FLASH_START  = 0x8A
 CMD_EXPORT_FLASH        = 0x8B
 CMD_EXPORT_FLASH_END    = 0x8C
@@ -125,4 +127,8 @@ CMD_GET_USER_CHANGE_NB	= 0xD6
 CMD_GET_FREE_NB_USR_SLT	= 0xD7
 CMD_SET_DESCRIPTION		= 0xD8
 CMD_LOCK_DEVICE			= 0xD9
-CMD_UNLOCK_WITH_PIN		= 0xDA
\ No newline at end of file
+CMD_UNLOCK_WITH_PIN		= 0xDA
+CMD_GET_NODE_DIGEST     = 0xDB
+CMD_CHECK_DB            = 0xDC
+CMD_STORE_CRED_BATCH    = 0xDD
+CMD_GET_FREE_NODE_RUN   = 0xDE
\ No newline at end of file
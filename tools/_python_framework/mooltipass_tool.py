@@ -29,7 +29,8 @@
 # Generate and upload signed firmware: mooltipass_tool.py packSignUpload bundleName firmwareName oldAesKey (newAesKey) password #
 # Initialize Mooltipass: mooltipass_tool.py init bundleName                                                                     #
 # Launch security checks for mini: mooltipass_tool.py minicheck oldfirmware newfirmware bundlename                              #
-#                                                                                                                               #
+# HID benchmark: mooltipass_tool.py benchmark (iterations) (results.json) (perf)                                                #
+# Sorted bulk load of a user backup into an empty user: mooltipass_tool.py bulk_load user_backup.bin                            #
 #                                                                                                                               #
 #                                                                                                                               #
 #                                                                                                                               #
@@ -37,6 +38,8 @@
 from mooltipass_hid_device import *
 from mooltipass_init_proc import *
 import mooltipass_security_check 
+import mooltipass_benchmark
+import mooltipass_bulk_load
 import firmwareBundlePackAndSign
 from datetime import datetime
 from array import array
@@ -159,6 +162,21 @@ def main():
 			
 		if sys.argv[1] == "lock":
 			mooltipass_device.lock()
+			
+		if sys.argv[1] == "benchmark":
+			iterations = mooltipass_benchmark.BENCHMARK_ITERATIONS
+			output_filename = "benchmark_" + version_data[1] + "_" + version_data[2] + ".json"
+			if len(sys.argv) > 2:
+				iterations = int(sys.argv[2])
+			if len(sys.argv) > 3:
+				output_filename = sys.argv[3]
+			mooltipass_benchmark.mooltipassBenchmark(mooltipass_device, iterations, output_filename, len(sys.argv) > 4 and sys.argv[4] == "perf")
+			
+		if sys.argv[1] == "bulk_load":
+			if len(sys.argv) > 2:
+				mooltipass_bulk_load.mooltipassBulkLoad(mooltipass_device, sys.argv[2])
+			else:
+				print "bulk_load: not enough args!"
 		
 		
 	#mooltipass_device.sendCustomPacket()
@@ -46,14 +46,74 @@ NODE_SIZE				= 132
 CMD_PING				= 0xA1
 CMD_MINI_FRAME_BUF_DATA = 0x9E
 
+BITMAP_FLAG_COMPRESSED	= 0x02
+CTRL_RUN				= 0x40
+CTRL_BACKREF			= 0x80
+MAX_LITERAL_LENGTH		= 64
+MAX_RUN_LENGTH			= 65
+MAX_BACKREF_LENGTH		= 17
+MAX_BACKREF_DISTANCE	= 8
+
 parser = OptionParser(usage = 'usage: %prog [options]')
 parser.add_option('-i', '--input', help='image to send to the screen', dest='input', default=None)
 parser.add_option('-r', '--reverse', help='set to inverse pixel data', action="store_true", dest='reverse', default=False)
+parser.add_option('-c', '--compress', help='compress pixel data', action="store_true", dest='compress', default=False)
 (options, args) = parser.parse_args()
 
 if options.input == None:
 	parser.error('input option is required')
 	
+# Compress the bitstream, see bitstreammini.h for the format
+def compress(bitstream):
+	compressed = []
+	literal = []
+	i = 0
+	
+	while i < len(bitstream):
+		# Length of the run starting at the current byte
+		run_length = 1
+		while i + run_length < len(bitstream) and run_length < MAX_RUN_LENGTH and bitstream[i + run_length] == bitstream[i]:
+			run_length += 1
+		
+		# Longest back reference in the decoded data history
+		backref_length = 0
+		backref_distance = 0
+		for distance in range(1, min(i, MAX_BACKREF_DISTANCE) + 1):
+			length = 0
+			while i + length < len(bitstream) and length < MAX_BACKREF_LENGTH and bitstream[i + length] == bitstream[i + length - distance]:
+				length += 1
+			if length > backref_length:
+				backref_length = length
+				backref_distance = distance
+		
+		# Flush pending literals before a run or back reference
+		if (run_length >= 3 and run_length > backref_length) or backref_length >= 2:
+			if len(literal) > 0:
+				compressed.append(len(literal) - 1)
+				compressed.extend(literal)
+				literal = []
+			if run_length >= 3 and run_length > backref_length:
+				compressed.append(CTRL_RUN | (run_length - 2))
+				compressed.append(bitstream[i])
+				i += run_length
+			else:
+				compressed.append(CTRL_BACKREF | ((backref_length - 2) << 3) | (backref_distance - 1))
+				i += backref_length
+		else:
+			literal.append(bitstream[i])
+			i += 1
+			if len(literal) == MAX_LITERAL_LENGTH:
+				compressed.append(len(literal) - 1)
+				compressed.extend(literal)
+				literal = []
+	
+	# Remaining literals
+	if len(literal) > 0:
+		compressed.append(len(literal) - 1)
+		compressed.extend(literal)
+		
+	return compressed
+
 def main():
 		
 	# Open image and convert it to monochrome
@@ -115,8 +175,20 @@ def main():
 	# Open file to write
 	fd = open(options.input.split('.')[0]+".img", 'wb');
 
+	# Compress data if it saves space
+	flags = 0
+	if options.compress:
+		compressed = compress(bitstream)
+		print "Compressed data size:", len(compressed), "bytes"
+		if len(compressed) < len(bitstream):
+			bitstream = compressed
+			dataSize = len(compressed)
+			flags = BITMAP_FLAG_COMPRESSED
+		else:
+			print "Compression doesn't save space, storing raw data"
+
 	# Write header
-	fd.write(pack('=HBBBH', img_size[0], img_size[1], 1, 0, dataSize))
+	fd.write(pack('=HBBBH', img_size[0], img_size[1], 1, flags, dataSize))
 	# Write data
 	fd.write(pack('<{}B'.format(len(bitstream)), *bitstream))
 	fd.close()
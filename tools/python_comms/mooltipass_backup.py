@@ -0,0 +1,150 @@
+#
+# Mooltipass user backup container
+#
+# The backup is written record by record while the user database is walked,
+# so it never has to be held in memory and an interrupted export can be
+# resumed from its last complete record.
+#
+# Header:	'MPBK' | version (1B) | user db change number (1B) | reserved (2B) | card CPZ (8B)
+# The CPZ identifies the user the backup was made for, version 1 headers don't have it
+# Record:	type (1B) | payload length (2B, LSB first) | payload
+# The last record is BACKUP_RECORD_END, its payload is the CRC-32 of all the preceding bytes
+#
+import struct
+import zlib
+import os
+
+BACKUP_MAGIC                    = "MPBK"
+BACKUP_VERSION                  = 2
+BACKUP_HEADER_SIZE              = 16
+BACKUP_HEADER_V1_SIZE           = 8
+BACKUP_CPZ_SIZE                 = 8
+BACKUP_RECORD_HEADER_SIZE       = 3
+
+BACKUP_RECORD_FAVORITE          = 0x01	# favorite id (1B) | parent address (2B) | child address (2B)
+BACKUP_RECORD_STARTING_PARENT   = 0x02	# starting parent address (2B)
+BACKUP_RECORD_NODE              = 0x03	# node address (2B) | node (132B)
+BACKUP_RECORD_CPZ_CTR           = 0x04	# CPZ (8B) | CTR nonce (16B)
+BACKUP_RECORD_CTR               = 0x05	# user CTR value (3B)
+BACKUP_RECORD_END               = 0xFF	# CRC-32 (4B)
+
+def backupCreate(filename, change_nb, cpz = chr(0)*BACKUP_CPZ_SIZE):
+	# create a new backup file, returns [file, crc]
+	backup_file = open(filename, "wb")
+	header = BACKUP_MAGIC + struct.pack('<BBH', BACKUP_VERSION, change_nb, 0) + cpz
+	backup_file.write(header)
+	return [backup_file, zlib.crc32(header)]
+
+def backupWriteRecord(backup_file, crc, record_type, payload):
+	# append a record to the backup, returns the updated crc
+	record = struct.pack('<BH', record_type, len(payload)) + payload
+	backup_file.write(record)
+	# flushed so that an interrupted export keeps its complete records
+	backup_file.flush()
+	return zlib.crc32(record, crc)
+
+def backupClose(backup_file, crc):
+	# write the end record and close the backup
+	backup_file.write(struct.pack('<BHI', BACKUP_RECORD_END, 4, crc & 0xFFFFFFFF))
+	backup_file.close()
+
+def backupReadHeader(backup_file):
+	# returns [version, change number, CPZ (None for version 1), crc of the header] or None if this isn't a backup
+	header = backup_file.read(BACKUP_HEADER_V1_SIZE)
+	if len(header) != BACKUP_HEADER_V1_SIZE or header[0:4] != BACKUP_MAGIC:
+		return None
+	[version, change_nb, reserved] = struct.unpack('<BBH', header[4:])
+	if version == 1:
+		cpz = None
+	elif version == BACKUP_VERSION:
+		cpz = backup_file.read(BACKUP_CPZ_SIZE)
+		if len(cpz) != BACKUP_CPZ_SIZE:
+			return None
+		header += cpz
+	else:
+		return None
+	return [version, change_nb, cpz, zlib.crc32(header)]
+
+def backupReadRecord(backup_file):
+	# returns [type, payload, raw record] or None if the record is incomplete
+	record_header = backup_file.read(BACKUP_RECORD_HEADER_SIZE)
+	if len(record_header) != BACKUP_RECORD_HEADER_SIZE:
+		return None
+	[record_type, length] = struct.unpack('<BH', record_header)
+	payload = backup_file.read(length)
+	if len(payload) != length:
+		return None
+	return [record_type, payload, record_header + payload]
+
+def backupRecords(filename):
+	# iterate over the records of a backup, checking its CRC at the end
+	backup_file = open(filename, "rb")
+	header = backupReadHeader(backup_file)
+	if header is None:
+		backup_file.close()
+		raise ValueError("Not a backup file")
+	crc = header[3]
+	while True:
+		record = backupReadRecord(backup_file)
+		if record is None:
+			backup_file.close()
+			raise ValueError("Incomplete backup file")
+		if record[0] == BACKUP_RECORD_END:
+			backup_file.close()
+			if struct.unpack('<I', record[1])[0] != crc & 0xFFFFFFFF:
+				raise ValueError("Backup file CRC mismatch")
+			return
+		crc = zlib.crc32(record[2], crc)
+		yield [record[0], record[1]]
+
+def backupVerify(filename):
+	# check that a backup is complete and uncorrupted
+	try:
+		for record in backupRecords(filename):
+			pass
+		return True
+	except (IOError, ValueError) as e:
+		print e
+		return False
+
+def backupResume(filename, change_nb, cpz):
+	# reopen an interrupted export made for the same card CPZ and user db change number
+	# returns [file, crc, starting parent record, last parent node record, last node record] or None
+	# records after the last node record are dropped, as they're quick to export again
+	if not os.path.isfile(filename):
+		return None
+	backup_file = open(filename, "r+b")
+	header = backupReadHeader(backup_file)
+	if header is None or header[1] != change_nb or header[2] != cpz:
+		backup_file.close()
+		return None
+	crc = header[3]
+	resume_offset = BACKUP_HEADER_SIZE
+	resume_crc = crc
+	starting_parent = None
+	last_parent = None
+	last_node = None
+	while True:
+		record = backupReadRecord(backup_file)
+		if record is None or record[0] in (BACKUP_RECORD_CPZ_CTR, BACKUP_RECORD_CTR, BACKUP_RECORD_END):
+			break
+		crc = zlib.crc32(record[2], crc)
+		if record[0] == BACKUP_RECORD_STARTING_PARENT:
+			starting_parent = record[1]
+		elif record[0] == BACKUP_RECORD_NODE:
+			last_node = record[1]
+			if backupIsParentNode(record[1][2:]):
+				last_parent = record[1]
+		resume_offset = backup_file.tell()
+		resume_crc = crc
+	# nodes are only exported after the starting parent
+	if starting_parent is None:
+		backup_file.close()
+		return None
+	backup_file.seek(resume_offset)
+	backup_file.truncate()
+	return [backup_file, resume_crc, starting_parent, last_parent, last_node]
+
+def backupIsParentNode(node):
+	# node type is in the 2 MSBs of the flags (LSB first), 0 for a parent
+	return (ord(node[1]) >> 6) == 0
@@ -9,11 +9,14 @@ import random
 import struct
 import string
 import pickle
+import csv
+import zlib
 import copy
 import time
 import sys
 import os
 from keyboard import *
+from mooltipass_backup import *
 
 USB_VID                 = 0x16D0
 USB_PID                 = 0x09A0
@@ -28,6 +31,11 @@ SERVICE_INDEX           = 0x08
 DESC_INDEX              = 6
 LOGIN_INDEX             = 37
 NODE_SIZE				= 132
+NODE_START_ADDRESS      = 0x0800
+NODE_MIRROR_FILE        = "node_mirror.bin"
+NODE_WRITE_CHUNK_SIZE   = 59
+BACKUP_FILE             = "user_backup.bin"
+IMPORT_PIPELINE_DEPTH   = 2
 
 CMD_EXPORT_FLASH_START  = 0x8A
 CMD_EXPORT_FLASH        = 0x8B
@@ -101,6 +109,14 @@ CMD_SET_DN_START_PARENT = 0xD2
 CMD_END_MEMORYMGMT      = 0xD3
 CMD_GET_DESCRIPTION		= 0xD4
 CMD_UNLOCK_WITH_PIN		= 0xD5
+CMD_GET_USER_CHANGE_NB  = 0xD6
+CMD_GET_NODE_DIGEST     = 0xDB
+CMD_CHECK_DB            = 0xDC
+CMD_STORE_CRED_BATCH    = 0xDD
+
+BATCH_FIELD_SERVICE     = 0x00
+BATCH_FIELD_LOGIN       = 0x01
+BATCH_FIELD_PASSWORD    = 0x02
 
 def keyboardSend(epout, data1, data2):
 	packetToSend = array('B')
@@ -1171,140 +1187,310 @@ def favoriteSelectionScreen(epin, epout):
 	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
 	receiveHidPacket(epin)
 	
-def exportUser(epin, epout):
-	parent_nodes_addr_export = list()
-	parent_nodes_export = list()
-	child_nodes_addr_export = list()
-	child_nodes_export = list()
-	cpz_ctr_export = list()
-	favorites_export = list()
-	next_service_addr = array('B')
-	next_child_addr = array('B')
-
+def startMemoryManagement(epin, epout):
 	# start memory management
 	sendHidPacket(epout, CMD_START_MEMORYMGMT, 0, None)
 	print "Please accept memory management mode on the MP"
 	while receiveHidPacket(epin)[DATA_INDEX] != 1:
 		print "Please accept memory management mode on the MP"
 		sendHidPacket(epout, CMD_START_MEMORYMGMT, 0, None)
-		
-	# get favorites
-	favoriteArg = array('B')
-	favoriteArg.append(0)
-	# loop through fav slots
-	for count in range(0, 14):
-		favoriteArg[0] = count
-		# request favorite
-		sendHidPacket(epout, CMD_GET_FAVORITE, 1, favoriteArg)
-		favorites_export.append(receiveHidPacket(epin)[DATA_INDEX:DATA_INDEX+4])
-	
-	# write the favorites
-	pickle_write(favorites_export, "favorites.txt")
 
-	# get starting node
-	sendHidPacket(epout, CMD_GET_STARTING_PARENT, 0, None)
+def readFlashNode(epin, epout, address):
+	# read a node, sent by the device in 3 packets
+	sendHidPacket(epout, CMD_READ_FLASH_NODE, 2, array('B', struct.pack('<H', address)))
+	data_node = array('B')
+	while len(data_node) < NODE_SIZE:
+		data = receiveHidPacket(epin)
+		if data[LEN_INDEX] == 1:
+			sys.exit("Couldn't read node")
+		data_node.extend(data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]])
+	return data_node
+
+def getNodeAddressField(node, index):
+	return node[index] + node[index+1]*256
+
+def setNodeAddressField(node, index, address):
+	node[index] = address & 0xFF
+	node[index+1] = address >> 8
+
+def exportUser(epin, epout):
+	# get the card CPZ and the user db change number, a partial backup is only resumed for the same user if the db didn't change
+	sendHidPacket(epout, CMD_GET_CUR_CPZ, 0, None)
+	data = receiveHidPacket(epin)
+	if data[LEN_INDEX] != BACKUP_CPZ_SIZE:
+		print "Couldn't get card CPZ, is the card unlocked?"
+		return
+	cpz = data[DATA_INDEX:DATA_INDEX+BACKUP_CPZ_SIZE].tostring()
+	sendHidPacket(epout, CMD_GET_USER_CHANGE_NB, 0, None)
 	data = receiveHidPacket(epin)
+	if data[DATA_INDEX] != 1:
+		print "Couldn't get user db change number, is the card unlocked?"
+		return
+	change_nb = data[DATA_INDEX+1]
 
-	# print starting node
-	print "Starting node address is at", format(data[DATA_INDEX] + data[DATA_INDEX+1]*256, '#04X')
-	next_service_addr.append(data[DATA_INDEX])
-	next_service_addr.append(data[DATA_INDEX+1])
-	next_child_addr.append(data[DATA_INDEX]);
-	next_child_addr.append(data[DATA_INDEX]);
-	
-	# write the starting node
-	pickle_write(next_service_addr, "starting_node.txt")
+	startMemoryManagement(epin, epout)
+
+	resume = backupResume(BACKUP_FILE, change_nb, cpz)
+	if resume is None:
+		[backup_file, crc] = backupCreate(BACKUP_FILE, change_nb, cpz)
+
+		# get favorites
+		for count in range(0, 14):
+			sendHidPacket(epout, CMD_GET_FAVORITE, 1, array('B', [count]))
+			data = receiveHidPacket(epin)
+			crc = backupWriteRecord(backup_file, crc, BACKUP_RECORD_FAVORITE, chr(count) + data[DATA_INDEX:DATA_INDEX+4].tostring())
+
+		# get starting node
+		sendHidPacket(epout, CMD_GET_STARTING_PARENT, 0, None)
+		data = receiveHidPacket(epin)
+		next_service_addr = getNodeAddressField(data, DATA_INDEX)
+		crc = backupWriteRecord(backup_file, crc, BACKUP_RECORD_STARTING_PARENT, data[DATA_INDEX:DATA_INDEX+2].tostring())
+		next_child_addr = 0
+		print "Starting node address is at", format(next_service_addr, '#04X')
+	else:
+		[backup_file, crc, starting_parent, last_parent, last_node] = resume
+		if last_node is None:
+			# no node exported yet
+			next_service_addr = struct.unpack('<H', starting_parent)[0]
+			next_child_addr = 0
+		else:
+			last_parent = array('B', last_parent[2:])
+			last_node = array('B', last_node[2:])
+			next_service_addr = getNodeAddressField(last_parent, NEXT_ADDRESS_INDEX)
+			if last_node == last_parent:
+				next_child_addr = getNodeAddressField(last_parent, NEXT_CHILD_INDEX)
+			else:
+				next_child_addr = getNodeAddressField(last_node, NEXT_ADDRESS_INDEX)
+		print "Resuming interrupted export"
+
+	# walk the parents and their children, each node is written as soon as it is read
+	while True:
+		while next_child_addr != 0:
+			data_child = readFlashNode(epin, epout, next_child_addr)
+			print "Found child node at", format(next_child_addr, '#04X'), "- login:", "".join(map(chr, data_child[LOGIN_INDEX:])).split(b"\x00")[0]
+			crc = backupWriteRecord(backup_file, crc, BACKUP_RECORD_NODE, struct.pack('<H', next_child_addr) + data_child.tostring())
+			next_child_addr = getNodeAddressField(data_child, NEXT_ADDRESS_INDEX)
+		if next_service_addr == 0:
+			break
+		data_parent = readFlashNode(epin, epout, next_service_addr)
+		print "Found parent node at", format(next_service_addr, '#04X'), "- service name:", "".join(map(chr, data_parent[SERVICE_INDEX:])).split(b"\x00")[0]
+		crc = backupWriteRecord(backup_file, crc, BACKUP_RECORD_NODE, struct.pack('<H', next_service_addr) + data_parent.tostring())
+		next_child_addr = getNodeAddressField(data_parent, NEXT_CHILD_INDEX)
+		next_service_addr = getNodeAddressField(data_parent, NEXT_ADDRESS_INDEX)
 
-	# start printing credentials, loop until next service address is equal to node_addr_null
-	while next_service_addr[0] != 0 or next_service_addr[1] != 0:
-		# request parent node
-		sendHidPacket(epout, CMD_READ_FLASH_NODE, 2, next_service_addr)
-		# read it and keep the node part
-		data_parent = receiveHidPacket(epin)
-		data_parent.extend(receiveHidPacket(epin))
-		data_parent.extend(receiveHidPacket(epin))
-		data_parent = data_parent[DATA_INDEX:DATA_INDEX+NODE_SIZE]
-		# store node data together with its address
-		print "Found parent node at", format(next_service_addr[0] + next_service_addr[1]*256, '#04X'), "- service name:", "".join(map(chr, data_parent[SERVICE_INDEX:])).split(b"\x00")[0]
-		parent_nodes_addr_export.append(next_service_addr)
-		parent_nodes_export.append(data_parent)
-		# extract next child address
-		next_child_addr[0] = data_parent[NEXT_CHILD_INDEX]
-		next_child_addr[1] = data_parent[NEXT_CHILD_INDEX+1]
-		# loop in the child nodes
-		while next_child_addr[0] != 0 or next_child_addr[1] != 0:
-			# request child node
-			sendHidPacket(epout, CMD_READ_FLASH_NODE, 2, next_child_addr)
-			# read it
-			data_child = receiveHidPacket(epin)
-			data_child.extend(receiveHidPacket(epin))
-			data_child.extend(receiveHidPacket(epin))
-			data_child = data_child[DATA_INDEX:DATA_INDEX+NODE_SIZE]
-			# truncate data to get login
-			print "Found child node at", format(next_child_addr[0] + next_child_addr[1]*256, '#04X'), "- login:", "".join(map(chr, data_child[LOGIN_INDEX:])).split(b"\x00")[0]
-			child_nodes_addr_export.append(next_child_addr)
-			child_nodes_export.append(data_child)
-			# extract next child address
-			next_child_addr = array('B')
-			next_child_addr.append(data_child[NEXT_ADDRESS_INDEX])
-			next_child_addr.append(data_child[NEXT_ADDRESS_INDEX+1])
-		# extract next parent address (see gNode def)
-		next_service_addr = array('B')
-		next_service_addr.append(data_parent[NEXT_ADDRESS_INDEX])
-		next_service_addr.append(data_parent[NEXT_ADDRESS_INDEX+1])
-
-	# write the export
-	pickle_write(parent_nodes_addr_export, "parent_nodes_addr.txt")
-	pickle_write(parent_nodes_export, "parent_nodes.txt")
-	pickle_write(child_nodes_addr_export, "child_nodes_addr.txt")
-	pickle_write(child_nodes_export, "child_nodes.txt")
-	
 	# get the CPZ & CTR LUT entries
 	sendHidPacket(epout, CMD_GET_CARD_CPZ_CTR, 0, None)
-	temp_bool = True
-	while temp_bool == True:
+	while True:
 		received_data = receiveHidPacket(epin)
 		# check if we received end of export packet
 		if received_data[CMD_INDEX] == CMD_GET_CARD_CPZ_CTR:
-			temp_bool = False
-		else:
-			cpz_ctr_export.append(received_data[DATA_INDEX:DATA_INDEX + received_data[LEN_INDEX]])
-		
-	# write the export
-	pickle_write(cpz_ctr_export, "cpz_ctr_export.txt")
-	
+			break
+		crc = backupWriteRecord(backup_file, crc, BACKUP_RECORD_CPZ_CTR, received_data[DATA_INDEX:DATA_INDEX + received_data[LEN_INDEX]].tostring())
+
 	# get the user CTR value
 	sendHidPacket(epout, CMD_GET_CTRVALUE, 0, None)
 	ctr_packet = receiveHidPacket(epin)
-	pickle_write(ctr_packet[DATA_INDEX:DATA_INDEX + ctr_packet[LEN_INDEX]], "ctr_value.txt")
-	
+	crc = backupWriteRecord(backup_file, crc, BACKUP_RECORD_CTR, ctr_packet[DATA_INDEX:DATA_INDEX + ctr_packet[LEN_INDEX]].tostring())
+	backupClose(backup_file, crc)
+	print "User exported to", BACKUP_FILE
+
 	# end memory management mode
 	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
 	receiveHidPacket(epin)
-	
+
+def importSendPipelined(epin, epout, import_state, cmd, data):
+	# send a packet without waiting for its answer, up to IMPORT_PIPELINE_DEPTH packets in flight
+	# the device buffers 2 received reports (USB_RX_RING_SIZE) behind its double-banked OUT endpoint
+	# and queues 2 answers (USB_TX_QUEUE_SIZE), so none is dropped while it writes a node
+	if import_state["in_flight"] == IMPORT_PIPELINE_DEPTH:
+		importReceiveAnswer(epin, import_state)
+	sendHidPacket(epout, cmd, len(data), data)
+	import_state["in_flight"] += 1
+
+def importReceiveAnswer(epin, import_state):
+	data = receiveHidPacket(epin)
+	import_state["in_flight"] -= 1
+	if data[DATA_INDEX] != 1:
+		sys.exit("Mooltipass refused import packet " + format(data[CMD_INDEX], '#02X'))
+
+def importFlush(epin, import_state):
+	while import_state["in_flight"] != 0:
+		importReceiveAnswer(epin, import_state)
+
+def importGetNewAddress(epin, epout, import_state, address):
+	# the node at a given backup address is written to the next free slot, allocated when the address is first seen
+	if address not in import_state["address_map"]:
+		if len(import_state["free_slots"]) == 0:
+			# the answer can only be received once the pipelined packets are answered
+			importFlush(epin, import_state)
+			sendHidPacket(epout, CMD_GET_30_FREE_SLOTS, 2, array('B', struct.pack('<H', import_state["scan_address"])))
+			data = receiveHidPacket(epin)
+			if data[LEN_INDEX] < 2:
+				sys.exit("No free slots left on the Mooltipass")
+			import_state["free_slots"] = list(struct.unpack('<' + 'H'*(data[LEN_INDEX]/2), data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]].tostring()))
+			import_state["scan_address"] = import_state["free_slots"][-1] + 1
+		import_state["address_map"][address] = import_state["free_slots"].pop(0)
+	return import_state["address_map"][address]
+
 def importUser(epin, epout):
-	#print "parent nodes:"
-	#print pickle_read("parent_nodes.txt")
-	#print "child nodes:"
-	#print pickle_read("child_nodes.txt")
-	#print "parent addr:"
-	#print pickle_read("parent_nodes_addr.txt")
-	#print "child addr:"
-	#print pickle_read("child_nodes_addr.txt")
-	#print "cpz ctr:"
-	#print pickle_read("cpz_ctr_export.txt")
-	#print "ctr:"
-	#print pickle_read("ctr_value.txt")
-	#print "starting:"
-	#print pickle_read("starting_node.txt")
-	
-	# Check Mootipass status
-	sendHidPacket(epout, CMD_MOOLTIPASS_STATUS, 0, None)
-	if receiveHidPacket(epin)[DATA_INDEX] == 9:
-		# Unknown card inserted
-		print "Unknown card inserted"
+	# check the whole backup before touching the device
+	if not backupVerify(BACKUP_FILE):
+		print "Invalid backup file", BACKUP_FILE
+		return
+
+	startMemoryManagement(epin, epout)
+
+	# only import in an empty user profile, not to lose the current nodes
+	sendHidPacket(epout, CMD_GET_STARTING_PARENT, 0, None)
+	data = receiveHidPacket(epin)
+	if data[LEN_INDEX] != 2 or getNodeAddressField(data, DATA_INDEX) != 0:
+		print "Current user isn't empty"
 	else:
-		print "Unsupported mode"
+		import_state = {"address_map": {0: 0}, "free_slots": [], "scan_address": NODE_START_ADDRESS, "in_flight": 0}
+		nb_nodes = 0
+		for [record_type, payload] in backupRecords(BACKUP_FILE):
+			if record_type == BACKUP_RECORD_FAVORITE:
+				[fav_id, parent_addr, child_addr] = struct.unpack('<BHH', payload)
+				parent_addr = importGetNewAddress(epin, epout, import_state, parent_addr)
+				child_addr = importGetNewAddress(epin, epout, import_state, child_addr)
+				importSendPipelined(epin, epout, import_state, CMD_SET_FAVORITE, array('B', struct.pack('<BHH', fav_id, parent_addr, child_addr)))
+			elif record_type == BACKUP_RECORD_STARTING_PARENT:
+				parent_addr = importGetNewAddress(epin, epout, import_state, struct.unpack('<H', payload)[0])
+				importSendPipelined(epin, epout, import_state, CMD_SET_STARTING_PARENT, array('B', struct.pack('<H', parent_addr)))
+			elif record_type == BACKUP_RECORD_NODE:
+				node = array('B', payload[2:])
+				node_addr = importGetNewAddress(epin, epout, import_state, struct.unpack('<H', payload[0:2])[0])
+				# update the links to the new addresses
+				for index in ([PREV_ADDRESS_INDEX, NEXT_ADDRESS_INDEX, NEXT_CHILD_INDEX] if backupIsParentNode(payload[2:]) else [PREV_ADDRESS_INDEX, NEXT_ADDRESS_INDEX]):
+					setNodeAddressField(node, index, importGetNewAddress(epin, epout, import_state, getNodeAddressField(node, index)))
+				# node is written in 59 bytes chunks: address, chunk number, data
+				for chunk in range(0, (NODE_SIZE + NODE_WRITE_CHUNK_SIZE - 1) / NODE_WRITE_CHUNK_SIZE):
+					importSendPipelined(epin, epout, import_state, CMD_WRITE_FLASH_NODE, array('B', struct.pack('<HB', node_addr, chunk)) + node[chunk*NODE_WRITE_CHUNK_SIZE:(chunk+1)*NODE_WRITE_CHUNK_SIZE])
+				nb_nodes += 1
+			elif record_type == BACKUP_RECORD_CPZ_CTR:
+				importFlush(epin, import_state)
+				sendHidPacket(epout, CMD_ADD_CARD_CPZ_CTR, len(payload), array('B', payload))
+				if receiveHidPacket(epin)[DATA_INDEX] != 1:
+					print "Couldn't add CPZ/CTR entry, already known?"
+			elif record_type == BACKUP_RECORD_CTR:
+				# never set the CTR back, as CTR values must not be reused
+				importFlush(epin, import_state)
+				sendHidPacket(epout, CMD_GET_CTRVALUE, 0, None)
+				data = receiveHidPacket(epin)
+				if array('B', payload).tolist() > data[DATA_INDEX:DATA_INDEX+len(payload)].tolist():
+					importSendPipelined(epin, epout, import_state, CMD_SET_CTRVALUE, array('B', payload))
+		importFlush(epin, import_state)
+		print nb_nodes, "nodes imported"
+
+	# end memory management mode
+	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
+	receiveHidPacket(epin)
+
+def getNodeRangeDigest(epin, epout, address, nb_slots):
+	# ask the digest of a node slot range, returns [crc32, address following the range, number of slots scanned]
+	sendHidPacket(epout, CMD_GET_NODE_DIGEST, 4, array('B', struct.pack('<HH', address, nb_slots)))
+	data = receiveHidPacket(epin)
+	if data[LEN_INDEX] != 8:
+		sys.exit("Couldn't get node range digest")
+	return list(struct.unpack('<IHH', data[DATA_INDEX:DATA_INDEX+8].tostring()))
+
+def getLocalNodeRangeDigest(node_mirror, address, next_address):
+	# same digest as the device over our copy: address then node contents, for each node in the range
+	crc = 0
+	for node_addr in sorted(node_mirror.keys()):
+		if node_addr >= address and (next_address == 0 or node_addr < next_address):
+			crc = zlib.crc32(struct.pack('<H', node_addr) + node_mirror[node_addr].tostring(), crc)
+	return crc & 0xFFFFFFFF
+
+def syncNodeRange(epin, epout, node_mirror, address, nb_slots):
+	# bisect until the digests match, returns [address following the range, number of nodes read]
+	[crc, next_address, nb_scanned] = getNodeRangeDigest(epin, epout, address, nb_slots)
+	if crc == getLocalNodeRangeDigest(node_mirror, address, next_address):
+		return [next_address, 0]
+	if nb_scanned == 1:
+		if crc == 0:
+			# slot not used by our user anymore
+			print "Node at", format(address, '#04X'), "removed"
+			del node_mirror[address]
+			return [next_address, 0]
+		else:
+			# read the changed node
+			node_mirror[address] = readFlashNode(epin, epout, address)
+			print "Node at", format(address, '#04X'), "updated"
+			return [next_address, 1]
+	[middle_address, nb_nodes_read_first] = syncNodeRange(epin, epout, node_mirror, address, nb_scanned/2)
+	[next_address, nb_nodes_read_second] = syncNodeRange(epin, epout, node_mirror, middle_address, nb_scanned - nb_scanned/2)
+	return [next_address, nb_nodes_read_first + nb_nodes_read_second]
+
+def syncUser(epin, epout):
+	startMemoryManagement(epin, epout)
+
+	# load our copy of the user nodes, indexed by address
+	node_mirror = dict()
+	if os.path.isfile(NODE_MIRROR_FILE) and backupVerify(NODE_MIRROR_FILE):
+		for [record_type, payload] in backupRecords(NODE_MIRROR_FILE):
+			if record_type == BACKUP_RECORD_NODE:
+				node_mirror[struct.unpack('<H', payload[0:2])[0]] = array('B', payload[2:])
+
+	# only fetch the nodes in the ranges whose digests differ
+	[next_address, nb_nodes_read] = syncNodeRange(epin, epout, node_mirror, NODE_START_ADDRESS, 0xFFFF)
+	print len(node_mirror), "user nodes,", nb_nodes_read, "read from the device"
+	[mirror_file, crc] = backupCreate(NODE_MIRROR_FILE, 0)
+	for node_addr in sorted(node_mirror.keys()):
+		crc = backupWriteRecord(mirror_file, crc, BACKUP_RECORD_NODE, struct.pack('<H', node_addr) + node_mirror[node_addr].tostring())
+	backupClose(mirror_file, crc)
+
+	# end memory management mode
+	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
+	receiveHidPacket(epin)
+
+def checkUserDatabase(epin, epout):
+	startMemoryManagement(epin, epout)
+
+	# the check & repair is done by the device
+	sendHidPacket(epout, CMD_CHECK_DB, 0, None)
+	data = receiveHidPacket(epin)
+	if data[LEN_INDEX] != 16:
+		print "Database check failed"
+	else:
+		[nb_parents, nb_children, nb_data_parents, nb_data_nodes, nb_orphans, nb_unsorted, nb_repaired, nb_cross_links] = struct.unpack('<8H', data[DATA_INDEX:DATA_INDEX+16].tostring())
+		print nb_parents, "parent nodes,", nb_children, "child nodes,", nb_data_parents, "data parent nodes,", nb_data_nodes, "data nodes"
+		print nb_orphans, "orphan nodes,", nb_unsorted, "unsorted nodes,", nb_repaired, "links repaired,", nb_cross_links, "cross-links"
+
+	# end memory management mode
+	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
+	receiveHidPacket(epin)
+
+def storeCredentialBatch(epin, epout):
+	# credentials file: one "service,login,password" line per credential
+	file_name = raw_input("Enter credentials file name: ")
+	credentials = list()
+	with open(file_name, "rb") as credentials_file:
+		for row in csv.reader(credentials_file):
+			if len(row) != 3 or len(row[0]) == 0 or len(row[0]) > 57 or len(row[1]) > 62 or len(row[2]) > 31:
+				print "Skipping invalid line:", row
+				continue
+			credentials.append([row[0].lower(), row[1], row[2]])
+
+	# sorted like the parent list so that the device merges them in a single pass
+	credentials.sort()
+
+	startMemoryManagement(epin, epout)
+
+	import_state = {"in_flight": 0}
+	current_service = None
+	for [service, login, password] in credentials:
+		if service != current_service:
+			importSendPipelined(epin, epout, import_state, CMD_STORE_CRED_BATCH, array('B', chr(BATCH_FIELD_SERVICE) + service + "\x00"))
+			current_service = service
+		importSendPipelined(epin, epout, import_state, CMD_STORE_CRED_BATCH, array('B', chr(BATCH_FIELD_LOGIN) + login + "\x00"))
+		importSendPipelined(epin, epout, import_state, CMD_STORE_CRED_BATCH, array('B', chr(BATCH_FIELD_PASSWORD) + password + "\x00"))
+	importFlush(epin, import_state)
+	print len(credentials), "credentials stored"
+
+	# end memory management mode
+	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
+	receiveHidPacket(epin)
 
 def recoveryProc(epin, epout):
 	found_credential_sets = array('B')
@@ -1804,7 +1990,7 @@ if __name__ == '__main__':
 		print "24) Credential generator"
 		print "25) Set screen saver bool"
 		print "26) Export current user"
-		print "27) Import user to unknown card"
+		print "27) Import user backup to current empty user"
 		print "28) Check password for service & login"
 		print "29) Add a random block of data for new service"
 		print "30) Get decoded data for given service"
@@ -1820,6 +2006,9 @@ if __name__ == '__main__':
 		print "40) Try to unlock device with PIN"
 		print "41) Unknown card: get current CPZ"
 		print "42) Mooltipass mini: set contrast current"
+		print "43) Incremental sync of current user nodes"
+		print "44) Check & repair current user database on the device"
+		print "45) Store credentials from a CSV file in current user"
 		choice = input("Make your choice: ")
 		print ""
 
@@ -1943,6 +2132,12 @@ if __name__ == '__main__':
 				print ''.join('{:d} '.format(x) for x in data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]])
 		elif choice == 42:
 			setGenericParameter(epin, epout, 26)
+		elif choice == 43:
+			syncUser(epin, epout)
+		elif choice == 44:
+			checkUserDatabase(epin, epout)
+		elif choice == 45:
+			storeCredentialBatch(epin, epout)
 
 	hid_device.reset()
 